@@ -22,10 +22,26 @@
 #include <fstream>
 #include <array>
 #include <memory>
+#include <chrono>
+#include <future>
 
 #include "vertex.hpp"
 #include "object.hpp"
 #include "camera.hpp"
+#include "memory_allocator.hpp"
+#include "memory_telemetry.hpp"
+#include "staging_ring.hpp"
+#include "upload_context.hpp"
+#include "geometry_pool.hpp"
+#include "uniform_arena.hpp"
+#include "scene.hpp"
+#include "render_queue.hpp"
+#include "indirect_draw_list.hpp"
+#include "frustum_culler.hpp"
+#include "thread_pool.hpp"
+#include "command_buffer_cache.hpp"
+#include "deletion_queue.hpp"
+#include "shader_compiler.hpp"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
@@ -33,7 +49,57 @@ const uint32_t HEIGHT = 600;
 // const std::string MODEL_PATH = "models/42.obj";
 // const std::string TEXTURE_PATH = "textures/unicorn.ppm";
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+/* Frames the CPU can prepare while the GPU renders the previous ones, chosen at startup (--frames-in-flight) */
+const uint32_t MIN_FRAMES_IN_FLIGHT = 1;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+/* Presentation modes selectable with --present-mode, and at runtime with the P key */
+const uint32_t PRESENT_MODE_COUNT = 4;
+const VkPresentModeKHR PRESENT_MODES[PRESENT_MODE_COUNT] = {
+	VK_PRESENT_MODE_FIFO_KHR,
+	VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+	VK_PRESENT_MODE_MAILBOX_KHR,
+	VK_PRESENT_MODE_IMMEDIATE_KHR
+};
+const char* const PRESENT_MODE_NAMES[PRESENT_MODE_COUNT] = {"fifo", "fifo_relaxed", "mailbox", "immediate"};
+
+/* Size of the staging buffer shared by all the uploads */
+const VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+/* Larger textures are uploaded in bands of rows of at most this size, so that any texture fits in the ring */
+const VkDeviceSize STAGING_TEXTURE_BAND_SIZE = STAGING_RING_SIZE / 4;
+/* Uniform data of one frame in flight (per-frame and per-draw), bound with dynamic offsets */
+const VkDeviceSize UNIFORM_ARENA_FRAME_SIZE = 256 * 1024;
+/* File written by the memory telemetry, on demand (M key) and at shutdown */
+const std::string MEMORY_TELEMETRY_PATH = "memory_telemetry.json";
+/* Pipeline cache data saved at shutdown and loaded at startup */
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+/* SPIR-V of the shaders compiled at runtime, named after the hash of their source */
+const std::string SHADER_CACHE_DIRECTORY = "shader_cache";
+/* Capacity of the vertex and index buffers shared by all the meshes */
+const uint32_t GEOMETRY_POOL_MAX_VERTICES = 1 << 20;
+const uint32_t GEOMETRY_POOL_MAX_INDICES = 4 << 20;
+/* Pipeline field of the render queue keys */
+const uint32_t PIPELINE_DEFAULT = 0;
+const uint32_t PIPELINE_INSTANCED = 1;
+const uint32_t PIPELINE_INDIRECT = 2;
+/* Fragment shading of the pipeline variants, specialization constant 0 (SHADING_MODE) of the fragment shaders */
+const uint32_t SHADING_BLENDED = 0;
+const uint32_t SHADING_COLOR = 1;
+const uint32_t SHADING_TEXTURE = 2;
+const uint32_t SHADING_MODE_COUNT = 3;
+const char* const SHADING_MODE_NAMES[SHADING_MODE_COUNT] = {"blended", "color", "texture"};
+/* Draws of one frame that the indirect path can submit */
+const uint32_t MAX_INDIRECT_DRAWS = 64 * 1024;
+/* Passes of the occlusion culling: draws visible last frame, then the others tested against the depth pyramid */
+const uint32_t CULL_PHASE_EARLY = 0;
+const uint32_t CULL_PHASE_LATE = 1;
+/* Levels of the depth pyramid, enough for a 64k x 64k depth attachment */
+const uint32_t MAX_DEPTH_PYRAMID_LEVELS = 16;
+/* Size of the depth buffer the occluders are rasterized in on the CPU, whatever the size of the window */
+const uint32_t OCCLUSION_BUFFER_WIDTH = 256;
+const uint32_t OCCLUSION_BUFFER_HEIGHT = 128;
+/* Direct draws recorded by each thread at least, smaller draw lists are recorded in the primary command buffer */
+const size_t MIN_DRAWS_PER_RECORDING_CHUNK = 1024;
 
 #ifdef NDEBUG
 	const bool enableValidationLayers = false;
@@ -54,6 +120,8 @@ const std::vector<const char*> deviceExtensions = {
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	/* Optional family dedicated to transfers (no graphics support), used for asynchronous uploads */
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -70,12 +138,49 @@ typedef struct {
 	float ratio;
 } ColorTextureBlending;
 
+/* Pipeline variant compiled by a worker, written in its array once polled by the main thread */
+struct PendingPipeline {
+	std::array<VkPipeline, SHADING_MODE_COUNT>* variants;
+	uint32_t shadingMode;
+	std::string name;
+	/* The pipeline and the time the worker took to create it, in milliseconds */
+	std::future<std::pair<VkPipeline, double>> result;
+};
+
+/*
+ * Latency and throughput of the frames, measured on the CPU at the fence waits.
+ * The latency of a frame runs from the start of its drawFrame to the end of the fence wait of the frame taking its place,
+ * so it grows with the frames in flight when the GPU or the presentation is the bottleneck.
+ */
+struct FramePacing {
+	uint64_t frames = 0;
+	double latencyMilliseconds = 0.0;
+	/* Time the CPU was blocked waiting for the GPU to give back a frame */
+	double fenceWaitMilliseconds = 0.0;
+	std::chrono::high_resolution_clock::time_point start;
+	std::chrono::high_resolution_clock::time_point end;
+};
+
+/* Parts of a graphics pipeline compiled once with VK_EXT_graphics_pipeline_library, its variants are linked from them */
+struct PipelineLibraries {
+	VkPipeline vertexInput;
+	VkPipeline preRasterization;
+	/* One per shading mode, only the specialization constant of the fragment shader differs */
+	std::array<VkPipeline, SHADING_MODE_COUNT> fragmentShaders;
+};
+
 class Application {
 public:
 	void run() {
 		this->initWindow();
 		this->initVulkan();
-		this->mainLoop();
+		if (this->instanceBenchmark) {
+			this->runInstanceBenchmark();
+		} else if (this->recordingBenchmark) {
+			this->runRecordingBenchmark();
+		} else {
+			this->mainLoop();
+		}
 		this->cleanup();
 	}
 
@@ -87,10 +192,35 @@ public:
 		this->texture_path = texture_path;
 	}
 
+	/* Render growing numbers of instances of the model instead of running the main loop */
+	void setInstanceBenchmark(bool instanceBenchmark) {
+		this->instanceBenchmark = instanceBenchmark;
+	}
+
+	/* Record a large scene with growing numbers of chunks instead of running the main loop */
+	void setRecordingBenchmark(bool recordingBenchmark) {
+		this->recordingBenchmark = recordingBenchmark;
+	}
+
+	/* More frames in flight keep the GPU busy when the CPU time of the frames varies, at the cost of latency */
+	void setFramesInFlight(uint32_t framesInFlight) {
+		if (framesInFlight < MIN_FRAMES_IN_FLIGHT || framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+			throw std::runtime_error("frames in flight must be between " + std::to_string(MIN_FRAMES_IN_FLIGHT) + " and " + std::to_string(MAX_FRAMES_IN_FLIGHT) + "!");
+		}
+		this->framesInFlight = framesInFlight;
+	}
+
+	/* Requested presentation mode, FIFO is used instead if the surface does not support it */
+	void setPresentMode(VkPresentModeKHR presentMode) {
+		this->presentMode = presentMode;
+	}
+
 private:
 
 	std::string model_path;
 	std::string texture_path;
+	bool instanceBenchmark = false;
+	bool recordingBenchmark = false;
 
 	GLFWwindow* window;
 
@@ -101,10 +231,17 @@ private:
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
 
+	MemoryAllocator allocator;
+	MemoryTelemetry memoryTelemetry;
+	bool memoryBudgetSupported = false;
+
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	/* VK_NULL_HANDLE if the device has no dedicated transfer family */
+	VkQueue transferQueue = VK_NULL_HANDLE;
 
-	VkSwapchainKHR swapChain;
+	/* Given as oldSwapchain to its replacement, so the frames in flight can still present to it */
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
@@ -113,21 +250,72 @@ private:
 
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	/* Never rewritten: the uniform buffers are selected with dynamic offsets */
+	VkDescriptorSet descriptorSet;
 
 	VkRenderPass renderPass;
+	/* Compatible with renderPass, used around the depth pyramid by the occlusion culling:
+		the early pass keeps the depth and the color for the late pass, which loads them and presents */
+	VkRenderPass earlyRenderPass;
+	VkRenderPass lateRenderPass;
 	VkPipelineLayout pipelineLayout;
-	VkPipeline graphicsPipeline;
+	/* One variant per shading mode, indexed by SHADING_* */
+	std::array<VkPipeline, SHADING_MODE_COUNT> graphicsPipelines;
+	/* Same as graphicsPipelines with the per-instance attributes of binding 1 */
+	std::array<VkPipeline, SHADING_MODE_COUNT> instancedPipelines;
+	/* Same as graphicsPipelines with the per-draw data read from a storage buffer instead of push constants */
+	std::array<VkPipeline, SHADING_MODE_COUNT> indirectPipelines;
+
+	/* Used by the creation of every pipeline, saved in PIPELINE_CACHE_PATH for the next run */
+	VkPipelineCache pipelineCache;
+	/* Bytes of cache data given to the driver at startup, 0 for a cold start */
+	size_t pipelineCacheLoadedSize = 0;
+	double pipelineCreationMilliseconds = 0.0;
+	/* GLSL sources compiled when the pipelines are created */
+	ShaderCompiler shaderCompiler{SHADER_CACHE_DIRECTORY};
+	/* Variants compiled in the background, the blended one of the same pipeline draws in their place until they are ready */
+	std::unique_ptr<ThreadPool> pipelineCompilePool;
+	std::vector<PendingPipeline> pendingPipelines;
+	/* Frames drawn with a fallback pipeline because the variant they wanted was still compiling */
+	uint64_t fallbackPipelineFrameCount = 0;
+	/* With VK_EXT_graphics_pipeline_library, every variant is fast-linked from libraries, then replaced by an optimized link */
+	bool pipelineLibrarySupported = false;
+	std::vector<PipelineLibraries> pipelineLibraries;
+	/* Shared by every pipeline: they all draw to the same attachments */
+	VkPipeline fragmentOutputLibrary = VK_NULL_HANDLE;
 
 	VkCommandPool commandPool;
+	/* One per frame in flight and swap chain image, frame * image count + image, submitted again while nothing they use changes */
 	std::vector<VkCommandBuffer> commandBuffers;
+	CommandBufferCache commandBufferCache;
+	/* State of the frame being drawn, kept to avoid allocating it every frame */
+	RecordingState recordingState;
+	/* Parallel recording of the draws: one command pool per frame in flight and chunk, each chunk being recorded by one thread */
+	uint32_t recordingChunkCount = 1;
+	/* At most this many chunks are recorded per frame, lowered by the recording benchmark */
+	uint32_t recordingChunkLimit = UINT32_MAX;
+	/* CPU time spent recording primary command buffers with their chunks */
+	double recordingMilliseconds = 0.0;
+	std::vector<VkCommandPool> secondaryCommandPools;
+	/* Chunks of each primary command buffer, (frame * image count + image) * chunk count + chunk */
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+	/* Workers recording every chunk but the first, created with the first large draw list */
+	std::unique_ptr<ThreadPool> recordingPool;
+
+	StagingRing stagingRing;
+	VkBuffer stagingRingBuffer;
+	Allocation stagingRingMemory;
+
+	UploadContext uploadContext;
+	/* Ticket of the last batch of uploads submitted */
+	UploadTicket uploadTicket = 0;
 
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	Allocation depthImageMemory;
 	VkImageView depthImageView;
 
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	Allocation textureImageMemory;
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 
@@ -138,25 +326,128 @@ private:
 	Camera camera = Camera(ft::vec3(0.0f, 0.0f, 7.0f), ft::vec3(0.0f, 0.0f, 0.0f), ft::vec3(0.0f, 1.0f, 0.0f));
 	std::unique_ptr<Object> object;
 
+	/* Vertex and index buffers of the geometry pool */
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	Allocation vertexBufferMemory;
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
-
-	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
-	std::vector<void*> uniformBuffersMapped;
+	Allocation indexBufferMemory;
+	GeometryPool<Vertex> geometryPool;
+
+	Scene scene;
+	/* Scene object moved with the keyboard */
+	uint32_t selectedObject = 0;
+	/* Draws of the frame being recorded, sorted to minimize the state changes */
+	RenderQueue renderQueue;
+
+	VkBuffer uniformArenaBuffer;
+	Allocation uniformArenaMemory;
+	UniformArena uniformArena;
+	/* Uniforms of the frame being recorded and their dynamic offset in the arena */
+	FrameUniforms frameUniforms;
+	uint32_t frameUniformsOffset = 0;
+	/* Pushed with the draw of each scene object, indexed like the objects of the scene */
+	std::vector<DrawPushConstants> drawPushConstants;
+
+	/* Instances of the object, one buffer per frame in flight, VK_NULL_HANDLE until the first instance */
+	std::vector<VkBuffer> instanceBuffers;
+	std::vector<Allocation> instanceBufferMemories;
+	std::vector<uint32_t> instanceBufferCapacities;
+	/* Number of instances drawn by the frame being recorded, 0 to draw the object once without instancing */
+	uint32_t frameInstanceCount = 0;
+
+	/* Draw commands and per-draw data of the indirect path, one region per frame in flight */
+	VkBuffer indirectCommandBuffer;
+	Allocation indirectCommandMemory;
+	VkBuffer drawDataBuffer;
+	Allocation drawDataMemory;
+	IndirectDrawList<DrawData> indirectDraws;
+	/* Dynamic offset of the draw data of the frame being recorded */
+	uint32_t drawDataOffset = 0;
+	/* drawIndirectFirstInstance, needed to index the draw data with gl_InstanceIndex */
+	bool indirectDrawSupported = false;
+	/* multiDrawIndirect, otherwise the indirect draws are submitted one command at a time */
+	bool multiDrawIndirectSupported = false;
+	/* VK_KHR_draw_indirect_count, nullptr if not supported */
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+	/* Submit the non instanced draws with vkCmdDrawIndexedIndirect* instead of one vkCmdDrawIndexed each (I key) */
+	bool indirectDrawEnabled = false;
+
+	/* GPU culling of the indirect draws: world bounding sphere of each draw and the commands surviving the compute pass */
+	VkBuffer cullBoundsBuffer;
+	Allocation cullBoundsMemory;
+	VkBuffer culledCommandBuffer;
+	Allocation culledCommandMemory;
+	VkDescriptorSetLayout cullDescriptorSetLayout;
+	VkDescriptorPool cullDescriptorPool;
+	VkDescriptorSet cullDescriptorSet;
+	VkPipelineLayout cullPipelineLayout;
+	VkPipeline cullPipeline;
+	/* The graphics family supports compute and the indirect path is available */
+	bool gpuCullingSupported = false;
+	/* Cull the indirect draws on the GPU before drawing them (C key) */
+	bool gpuCullingEnabled = false;
+	/* World bounding sphere of each scene object for the frame being recorded */
+	std::vector<BoundingSphere> drawBounds;
+	/* CPU culling of the scene objects when the GPU does not cull them: the bounds in SIMD friendly arrays and the result of the test */
+	FrustumCuller frustumCuller;
+	std::vector<uint8_t> drawVisibility;
+	/* Workers sharing the culling of very large scenes, created with the first one */
+	std::unique_ptr<ThreadPool> cullingPool;
+	/* CPU occlusion culling: the occluders of the scene rasterized every frame, and the objects they hide culled (O key) */
+	OcclusionRasterizer occlusionRasterizer;
+	bool cpuOcclusionEnabled = true;
+
+	/* Occlusion culling of the indirect draws against a depth pyramid, in two phases (see shaders/cull.comp) */
+	VkBuffer cullVisibilityBuffer;
+	Allocation cullVisibilityMemory;
+	VkDescriptorSetLayout occlusionDescriptorSetLayout;
+	/* Allocated with the depth pyramid */
+	VkDescriptorSet occlusionDescriptorSet;
+	VkPipelineLayout occlusionCullPipelineLayout;
+	VkPipeline occlusionCullPipeline;
+	/* GPU culling is supported and the depth attachment can be sampled */
+	bool occlusionCullingSupported = false;
+	/* Draw the occluded indirect draws or not (H key) */
+	bool occlusionCullingEnabled = false;
+
+	/* Farthest depth of the depth attachment, halved at each level, rebuilt every frame by the occlusion culling */
+	VkImage depthPyramidImage;
+	Allocation depthPyramidMemory;
+	/* Every level, sampled by the culling, and one view per level, written by the reduction */
+	VkImageView depthPyramidView;
+	std::vector<VkImageView> depthPyramidLevelViews;
+	VkSampler depthPyramidSampler;
+	uint32_t depthPyramidWidth = 0;
+	uint32_t depthPyramidHeight = 0;
+	uint32_t depthPyramidLevels = 0;
+	VkDescriptorSetLayout depthReduceDescriptorSetLayout;
+	/* Recreated with the pyramid: holds its reduction sets and the occlusion culling set which samples it */
+	VkDescriptorPool depthReduceDescriptorPool;
+	/* One per level: the level above (or the depth attachment) as input, the level as output */
+	std::vector<VkDescriptorSet> depthReduceDescriptorSets;
+	VkPipelineLayout depthReducePipelineLayout;
+	VkPipeline depthReducePipeline;
 
 	/* float passed to the fragment shader to switch between color and texture rendering */
 	bool textureEnabled = false;
-	ColorTextureBlending colorTextureBlending;
-	std::vector<VkBuffer> textureEnabledBuffers;
-	std::vector<VkDeviceMemory> textureEnabledBufferMemory;
-	std::vector<void*> textureEnabledBufferMapped;
+	ColorTextureBlending colorTextureBlending{};
+	/* Variant of the pipelines drawing this frame, only SHADING_BLENDED while the blend ratio is animated */
+	uint32_t shadingMode = SHADING_BLENDED;
 
 	bool framebufferResized = false;
 
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	/* Mode of the current swap chain, differs from presentMode when it is not supported */
+	VkPresentModeKHR swapChainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	/* CPU start of the frame last submitted in each frame in flight, its latency is known once its fence is waited for */
+	std::vector<std::chrono::high_resolution_clock::time_point> frameStartTimes;
+	FramePacing framePacing{};
+
 	uint32_t currentFrame = 0;
+	/* Frames submitted since the start, the objects retired by the deletion queue are destroyed once the frames using them are complete */
+	uint64_t submittedFrameCount = 0;
+	DeletionQueue deletionQueue;
 
 	void initVulkan() {
 		this->loadModel();
@@ -166,21 +457,31 @@ private:
 		this->createSurface();
 		this->pickPhysicalDevice();
 		this->createLogicalDevice();
+		this->createAllocator();
+		this->createPipelineCache();
 		this->createSwapChain();
 		this->createImageViews();
 		this->createRenderPass();
 		this->createDescriptorSetLayout();
 		this->createGraphicsPipeline();
 		this->createCommandPool();
+		this->createStagingRing();
+		this->createUploadContext();
 		this->createDepthResources();
 		this->createFramebuffers();
 		this->createTextureImage();
 		this->createTextureImageView();
 		this->createTextureSampler();
-		this->createVertexBuffer();
-		this->createIndexBuffer();
-		this->createMvpUniformBuffers();
-		this->createColorTextureBlendingBuffer();
+		this->createGeometryPool();
+		this->createScene();
+		this->flushUploads();
+		this->createUniformArena();
+		this->createInstanceBuffers();
+		this->createIndirectDrawBuffers();
+		this->createCullingResources();
+		this->createDepthPyramid();
+		this->logPipelineCreationTotal();
+		this->shaderCompiler.logTimings();
 		this->createDescriptorPool();
 		this->createDescriptorSets();
 		this->createCommandBuffers();
@@ -206,6 +507,12 @@ private:
 	void key_q(int key, int scancode, int action, int mods);
 	void key_e(int key, int scancode, int action, int mods);
 	void key_t(int key, int scancode, int action, int mods);
+	void key_m(int key, int scancode, int action, int mods);
+	void key_i(int key, int scancode, int action, int mods);
+	void key_c(int key, int scancode, int action, int mods);
+	void key_h(int key, int scancode, int action, int mods);
+	void key_o(int key, int scancode, int action, int mods);
+	void key_p(int key, int scancode, int action, int mods);
 
 	/* mouse_callback.cpp */
 	static void scrollCallback(GLFWwindow* window, double xpos, double ypos);
@@ -235,6 +542,9 @@ private:
 
 	/* logical_device.cpp */
 	void createLogicalDevice();
+	bool isDeviceExtensionSupported(const char* extensionName);
+	bool isMemoryBudgetSupported();
+	bool isPipelineLibrarySupported();
 
 	/* swap_chain.cpp */
 	void createSwapChain();
@@ -246,10 +556,11 @@ private:
 
 	/* image_views.cpp */
 	void createImageViews();
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel = 0, uint32_t levelCount = 1);
 
 	/* render_pass.cpp */
 	void createRenderPass();
+	VkRenderPass createRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout colorInitialLayout, VkImageLayout colorFinalLayout, VkImageLayout depthInitialLayout, VkAttachmentStoreOp depthStoreOp);
 
 	/* descriptor.cpp */
 	void createDescriptorSetLayout();
@@ -258,55 +569,134 @@ private:
 
 	/* graphics_pipeline.cpp */
 	void createGraphicsPipeline();
-	static std::vector<char> readFile(const std::string& filename);
-	VkShaderModule createShaderModule(const std::vector<char>& code);
+	void createPipelineVariants(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
+	VkPipeline createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, uint32_t shadingMode, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions, VkGraphicsPipelineLibraryFlagsEXT libraryFlags = 0);
+	VkShaderModule createShaderModule(const std::vector<uint32_t>& code);
+	VkShaderModule loadShaderModule(const std::string& path, const std::vector<std::string>& defines = {});
 
 	/* texture.cpp */
 	void createTextureImage();
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory, uint32_t mipLevels = 1);
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t firstRow = 0);
 	void createTextureImageView();
 	void createTextureSampler();
 
 	/* depth.cpp */
 	void createDepthResources();
 	VkFormat findDepthFormat();
+	bool isDepthFormatSampleable();
 	bool hasStencilComponent(VkFormat format);
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 	/* buffer.cpp */
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	void createAllocator();
+	void dumpMemoryTelemetry();
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory, AllocationStrategy strategy = AllocationStrategy::Buddy, const std::vector<uint32_t>& sharingFamilies = {});
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+	/* staging_ring.cpp */
+	void createStagingRing();
+
+	/* upload_context.cpp */
+	void createUploadContext();
+	void flushUploads();
 
 	/* frame_buffer.cpp */
 	void createFramebuffers();
 
-	/* vertex_buffer.cpp */
-	void createVertexBuffer();
+	/* geometry_pool.cpp */
+	void createGeometryPool();
+	Mesh uploadMesh(const Object& object);
 
-	/* index.cpp */
-	void createIndexBuffer();
+	/* scene.cpp */
+	void createScene();
 
 	/* uniform_buffer.cpp */
-	void createMvpUniformBuffers();
-	void createColorTextureBlendingBuffer();
+	void createUniformArena();
+
+	/* instancing.cpp */
+	void createInstanceBuffers();
+	uint32_t updateInstanceBuffer(uint32_t frame);
+	void destroyInstanceBuffer(uint32_t frame);
+	void defragmentInstanceBuffers();
+
+	/* indirect_draw.cpp */
+	void createIndirectDrawBuffers();
+	void writeIndirectDraws();
+	void recordIndirectDraws(VkCommandBuffer commandBuffer, VkDeviceSize culledRegionOffset = 0);
+
+	/* culling.cpp */
+	void createCullingResources();
+	void destroyCullingResources();
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t phase);
+	VkDeviceSize culledRegionOffset(uint32_t phase);
+
+	/* depth_pyramid.cpp */
+	void createDepthPyramid();
+	void createDepthPyramidImage();
+	void destroyDepthPyramidImage();
+	void destroyDepthPyramid();
+	void recordDepthPyramid(VkCommandBuffer commandBuffer);
+
+	/* benchmark.cpp */
+	void runInstanceBenchmark();
+	void runRecordingBenchmark();
 
 	/* command.cpp */
 	void createCommandPool();
 	void createCommandBuffers();
+	void destroyCommandBuffers();
+	void buildRecordingState(RecordingState& state);
 	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-	VkCommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	void recordDraws(VkCommandBuffer commandBuffer, const DrawItem* begin, const DrawItem* end);
+	void beginScenePass(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, VkSubpassContents contents);
+	void bindSceneState(VkCommandBuffer commandBuffer);
+
+	/* pipeline_cache.cpp */
+	void createPipelineCache();
+	bool isPipelineCacheDataValid(const std::vector<char>& data);
+	void savePipelineCache();
+	void destroyPipelineCache();
+	void logPipelineCreation(const std::string& name, std::chrono::high_resolution_clock::time_point start);
+	void logPipelineCreationTotal();
+
+	/* pipeline_compilation.cpp */
+	void compilePipelineAsync(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, uint32_t shadingMode, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
+	void pollPipelineCompilations();
+	void waitPipelineCompilations();
+	bool isShadingModeReady(uint32_t shadingMode);
+	void linkPipelineAsync(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, uint32_t shadingMode, const PipelineLibraries& libraries, const std::string& name);
+
+	/* pipeline_library.cpp */
+	void createPipelineVariantsFromLibraries(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
+	VkPipeline linkPipeline(const PipelineLibraries& libraries, uint32_t shadingMode, bool optimize);
+	void destroyPipelineLibraries();
+
+	/* parallel_recording.cpp */
+	void createSecondaryCommandPools();
+	void destroySecondaryCommandPools();
+	void allocateSecondaryCommandBuffers();
+	void freeSecondaryCommandBuffers(const std::vector<VkCommandBuffer>& commandBuffers, size_t imageCount);
+	size_t secondaryCommandBufferIndex(uint32_t frame, uint32_t imageIndex, uint32_t chunk);
+	void recordDrawsInParallel(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, size_t directDrawCount, uint32_t chunkCount);
+	void recordSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, const DrawItem* begin, const DrawItem* end);
 
 	/* sync_objects.cpp */
 	void createSyncObjects();
 
 	/* draw.cpp */
 	void drawFrame();
-	void updateMvpUniformBuffer(uint32_t currentImage);
-	void updateTextureEnabledBuffer(uint32_t currentImage);
+	uint32_t updateFrameUniforms();
+	void buildRenderQueue();
+	void cullOccludedObjects();
+	void updateColorTextureBlending();
+
+	/* frame_pacing.cpp */
+	void measureFramePacing(std::chrono::high_resolution_clock::time_point frameStart);
+	void logFramePacing();
+	static const char* getPresentModeName(VkPresentModeKHR presentMode);
 
 	/* time.cpp */
 	float getTime();
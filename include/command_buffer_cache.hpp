@@ -0,0 +1,95 @@
+#ifndef COMMAND_BUFFER_CACHE_HPP
+#define COMMAND_BUFFER_CACHE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+/* Bytes of everything a command buffer is recorded from: handles, offsets, flags and the values of the recorded commands */
+class RecordingState {
+
+public:
+
+	void clear() {
+		this->bytes.clear();
+	}
+
+	template <typename T>
+	void add(const T& p_value) {
+		static_assert(std::is_trivially_copyable<T>::value, "recording state values are compared byte by byte");
+		this->add(&p_value, sizeof(T));
+	}
+
+	void add(const void* p_data, size_t p_size) {
+		size_t offset = this->bytes.size();
+		this->bytes.resize(offset + p_size);
+		memcpy(this->bytes.data() + offset, p_data, p_size);
+	}
+
+	bool operator==(const RecordingState& p_other) const {
+		return this->bytes == p_other.bytes;
+	}
+
+private:
+
+	std::vector<uint8_t> bytes;
+
+};
+
+/**
+ * @brief Remembers what each cached command buffer was recorded from, so that it is only recorded again when that changes.
+ *
+ * What changes every frame must not be in the recorded commands but in buffers written by the CPU (uniforms, indirect draws),
+ * then a static scene submits the same command buffers frame after frame.
+ * Changes which are not in the state (e.g. a recreated pipeline) must invalidate the cache.
+*/
+class CommandBufferCache {
+
+public:
+
+	/* Every command buffer has to be recorded */
+	void resize(size_t p_count) {
+		this->states.assign(p_count, RecordingState());
+		this->recorded.assign(p_count, false);
+	}
+
+	/* Every command buffer has to be recorded again, e.g. after a pipeline was replaced */
+	void invalidate() {
+		std::fill(this->recorded.begin(), this->recorded.end(), false);
+	}
+
+	/**
+	 * @brief True if the command buffer p_index was recorded from p_state and can be submitted again.
+	 * Otherwise p_state is kept for the next frames, and the caller records the command buffer.
+	*/
+	bool reuse(size_t p_index, const RecordingState& p_state) {
+		if (this->recorded[p_index] && this->states[p_index] == p_state) {
+			this->reusedCount++;
+			return true;
+		}
+		this->states[p_index] = p_state;
+		this->recorded[p_index] = true;
+		this->recordedCount++;
+		return false;
+	}
+
+	uint64_t getReusedCount() const {
+		return this->reusedCount;
+	}
+
+	uint64_t getRecordedCount() const {
+		return this->recordedCount;
+	}
+
+private:
+
+	std::vector<RecordingState> states;
+	std::vector<bool> recorded;
+	uint64_t reusedCount = 0;
+	uint64_t recordedCount = 0;
+
+};
+
+#endif // COMMAND_BUFFER_CACHE_HPP
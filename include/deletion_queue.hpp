@@ -0,0 +1,56 @@
+#ifndef DELETION_QUEUE_HPP
+#define DELETION_QUEUE_HPP
+
+#include <deque>
+#include <functional>
+#include <utility>
+#include <cstdint>
+
+/**
+ * @brief Destructions of GPU objects deferred until the frames which may still use them are complete.
+ *
+ * A destruction is pushed with the number of frames submitted so far: every one of them may use the objects,
+ * so it runs once that many frames are complete. Frames complete in submission order, so the queue is sorted by frame.
+*/
+class DeletionQueue {
+
+public:
+
+	DeletionQueue() = default;
+
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	void push(uint64_t p_frame, std::function<void()> p_destroy) {
+		this->entries.emplace_back(p_frame, std::move(p_destroy));
+	}
+
+	/**
+	 * @brief Run the destructions of the frames up to p_completedFrames, in the order they were pushed.
+	*/
+	void collect(uint64_t p_completedFrames) {
+		while (!this->entries.empty() && this->entries.front().first <= p_completedFrames) {
+			std::function<void()> destroy = std::move(this->entries.front().second);
+			this->entries.pop_front();
+			destroy();
+		}
+	}
+
+	/**
+	 * @brief Run every destruction, the device must be idle.
+	*/
+	void flush() {
+		this->collect(UINT64_MAX);
+	}
+
+	size_t size() const {
+		return this->entries.size();
+	}
+
+private:
+
+	std::deque<std::pair<uint64_t, std::function<void()>>> entries;
+
+};
+
+#endif // DELETION_QUEUE_HPP
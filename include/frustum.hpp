@@ -0,0 +1,81 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <ft_glm/ft_glm.hpp>
+
+#include <cmath>
+
+/* Sphere bounding a mesh or an object, in the space of its owner */
+struct BoundingSphere {
+	ft::vec3 center = ft::vec3(0.0f, 0.0f, 0.0f);
+	float radius = 0.0f;
+};
+
+/**
+ * @brief The 6 planes of a view frustum, extracted from a projection * view matrix (Gribb-Hartmann).
+ *
+ * Each plane is (a, b, c, d) with the normal (a, b, c) normalized and pointing inside the frustum,
+ * so the signed distance of a point p to the plane is a * p.x + b * p.y + c * p.z + d.
+ *
+ * ft::perspective produces OpenGL clip depths (-w <= z <= w), the near plane is extracted with that convention.
+ * It is more permissive than the Vulkan one (0 <= z <= w), which keeps the tests conservative.
+*/
+struct Frustum {
+
+	enum Plane {
+		LEFT,
+		RIGHT,
+		BOTTOM,
+		TOP,
+		NEAR,
+		FAR,
+		PLANE_COUNT
+	};
+
+	float planes[PLANE_COUNT][4];
+
+	static Frustum fromMatrix(const ft::mat4& p_viewProj) {
+		/* ft matrices are column major: p_viewProj[column][row] */
+		float rows[4][4];
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				rows[row][column] = p_viewProj[column][row];
+			}
+		}
+
+		Frustum frustum;
+		for (int i = 0; i < 4; i++) {
+			frustum.planes[LEFT][i] = rows[3][i] + rows[0][i];
+			frustum.planes[RIGHT][i] = rows[3][i] - rows[0][i];
+			frustum.planes[BOTTOM][i] = rows[3][i] + rows[1][i];
+			frustum.planes[TOP][i] = rows[3][i] - rows[1][i];
+			frustum.planes[NEAR][i] = rows[3][i] + rows[2][i];
+			frustum.planes[FAR][i] = rows[3][i] - rows[2][i];
+		}
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++) {
+			float* p = frustum.planes[plane];
+			float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			if (length > 0.0f) {
+				for (int i = 0; i < 4; i++) {
+					p[i] /= length;
+				}
+			}
+		}
+		return frustum;
+	}
+
+	/* False only if the sphere is entirely outside one of the planes */
+	bool intersectsSphere(const ft::vec3& p_center, float p_radius) const {
+		for (int plane = 0; plane < PLANE_COUNT; plane++) {
+			const float* p = this->planes[plane];
+			if (p[0] * p_center[0] + p[1] * p_center[1] + p[2] * p_center[2] + p[3] < -p_radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+};
+
+#endif // FRUSTUM_HPP
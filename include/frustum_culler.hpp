@@ -0,0 +1,175 @@
+#ifndef FRUSTUM_CULLER_HPP
+#define FRUSTUM_CULLER_HPP
+
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__AVX__) || defined(__SSE__)
+# include <immintrin.h>
+#endif
+
+#include "frustum.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Bounding spheres stored as a structure of arrays, tested against a frustum 8 (AVX) or 4 (SSE) at a time.
+ *
+ * The SIMD width is chosen at compile time (make AVX=1 for 8 wide), the scalar test handles the last spheres
+ * and the builds without SSE. Every path computes the same expression in the same order, so they agree bit for bit.
+ *
+ * Large sets are split in chunks tested by the workers of a thread pool, the calling thread tests the first one.
+*/
+class FrustumCuller {
+
+public:
+
+#if defined(__AVX__)
+	static const size_t SIMD_WIDTH = 8;
+#elif defined(__SSE__)
+	static const size_t SIMD_WIDTH = 4;
+#else
+	static const size_t SIMD_WIDTH = 1;
+#endif
+
+	/* Below this many spheres per chunk, waking the workers costs more than the test */
+	static const size_t MIN_PARALLEL_CHUNK = 16 * 1024;
+
+	void clear() {
+		this->centerX.clear();
+		this->centerY.clear();
+		this->centerZ.clear();
+		this->radius.clear();
+	}
+
+	void reserve(size_t p_count) {
+		this->centerX.reserve(p_count);
+		this->centerY.reserve(p_count);
+		this->centerZ.reserve(p_count);
+		this->radius.reserve(p_count);
+	}
+
+	void push(const BoundingSphere& p_bounds) {
+		this->centerX.push_back(p_bounds.center[0]);
+		this->centerY.push_back(p_bounds.center[1]);
+		this->centerZ.push_back(p_bounds.center[2]);
+		this->radius.push_back(p_bounds.radius);
+	}
+
+	size_t size() const {
+		return this->radius.size();
+	}
+
+	/**
+	 * @brief Write 1 in p_visible[i] if the sphere i intersects the frustum, 0 otherwise.
+	 *
+	 * @param p_pool Workers sharing the test, nullptr to test every sphere on the calling thread.
+	*/
+	void cull(const Frustum& p_frustum, std::vector<uint8_t>& p_visible, ThreadPool* p_pool = nullptr) const {
+		size_t count = this->size();
+		p_visible.resize(count);
+
+		size_t chunkCount = p_pool != nullptr ? std::min(p_pool->size() + 1, count / MIN_PARALLEL_CHUNK) : 1;
+		if (chunkCount <= 1) {
+			this->cullRange(p_frustum, 0, count, p_visible.data());
+			return;
+		}
+
+		/* Chunks start on a multiple of the SIMD width so only the last one has a scalar tail */
+		size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+		chunkSize = (chunkSize + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+		std::vector<std::future<void>> chunks;
+		for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+			size_t end = std::min(begin + chunkSize, count);
+			uint8_t* visible = p_visible.data();
+			chunks.push_back(p_pool->submit([this, &p_frustum, begin, end, visible] {
+				this->cullRange(p_frustum, begin, end, visible);
+			}));
+		}
+		this->cullRange(p_frustum, 0, std::min(chunkSize, count), p_visible.data());
+
+		for (std::future<void>& chunk : chunks) {
+			chunk.get();
+		}
+	}
+
+	/**
+	 * @brief Test the spheres [p_begin, p_end) with the widest instructions available.
+	*/
+	void cullRange(const Frustum& p_frustum, size_t p_begin, size_t p_end, uint8_t* p_visible) const {
+		size_t i = p_begin;
+
+#if defined(__AVX__)
+		for (; i + 8 <= p_end; i += 8) {
+			__m256 x = _mm256_loadu_ps(&this->centerX[i]);
+			__m256 y = _mm256_loadu_ps(&this->centerY[i]);
+			__m256 z = _mm256_loadu_ps(&this->centerZ[i]);
+			__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&this->radius[i]));
+
+			__m256 outside = _mm256_setzero_ps();
+			for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+				const float* p = p_frustum.planes[plane];
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(p[0]), x),
+					_mm256_mul_ps(_mm256_set1_ps(p[1]), y)),
+					_mm256_mul_ps(_mm256_set1_ps(p[2]), z)),
+					_mm256_set1_ps(p[3]));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; lane++) {
+				p_visible[i + lane] = ((mask >> lane) & 1) ^ 1;
+			}
+		}
+#elif defined(__SSE__)
+		for (; i + 4 <= p_end; i += 4) {
+			__m128 x = _mm_loadu_ps(&this->centerX[i]);
+			__m128 y = _mm_loadu_ps(&this->centerY[i]);
+			__m128 z = _mm_loadu_ps(&this->centerZ[i]);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&this->radius[i]));
+
+			__m128 outside = _mm_setzero_ps();
+			for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+				const float* p = p_frustum.planes[plane];
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(p[0]), x),
+					_mm_mul_ps(_mm_set1_ps(p[1]), y)),
+					_mm_mul_ps(_mm_set1_ps(p[2]), z)),
+					_mm_set1_ps(p[3]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+			}
+
+			int mask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; lane++) {
+				p_visible[i + lane] = ((mask >> lane) & 1) ^ 1;
+			}
+		}
+#endif
+
+		this->cullRangeScalar(p_frustum, i, p_end, p_visible);
+	}
+
+	/**
+	 * @brief Test the spheres [p_begin, p_end) one at a time, the reference of the SIMD paths.
+	*/
+	void cullRangeScalar(const Frustum& p_frustum, size_t p_begin, size_t p_end, uint8_t* p_visible) const {
+		for (size_t i = p_begin; i < p_end; i++) {
+			ft::vec3 center(this->centerX[i], this->centerY[i], this->centerZ[i]);
+			p_visible[i] = p_frustum.intersectsSphere(center, this->radius[i]) ? 1 : 0;
+		}
+	}
+
+private:
+
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+};
+
+#endif // FRUSTUM_CULLER_HPP
@@ -0,0 +1,212 @@
+#ifndef GEOMETRY_POOL_HPP
+#define GEOMETRY_POOL_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+/*
+ * The place of a mesh in the geometry pool, in elements (not bytes).
+ * Drawn with vkCmdDrawIndexed(indexCount, ..., firstIndex, vertexOffset = firstVertex, ...).
+ */
+struct Mesh {
+	uint32_t firstVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+/**
+ * @brief First fit allocator of ranges in [0, capacity), the free ranges are kept sorted and merged on free.
+*/
+class RangeAllocator {
+
+public:
+
+	void init(uint32_t p_capacity) {
+		this->capacity = p_capacity;
+		this->used = 0;
+		this->freeRanges.clear();
+		if (p_capacity > 0) {
+			this->freeRanges.push_back({0, p_capacity});
+		}
+	}
+
+	/**
+	 * @brief Take p_count elements, return false if no free range is large enough.
+	*/
+	bool allocate(uint32_t p_count, uint32_t& p_offset) {
+		if (p_count == 0) {
+			p_offset = 0;
+			return true;
+		}
+
+		for (auto it = this->freeRanges.begin(); it != this->freeRanges.end(); it++) {
+			if (it->count < p_count) {
+				continue;
+			}
+
+			p_offset = it->offset;
+			it->offset += p_count;
+			it->count -= p_count;
+			if (it->count == 0) {
+				this->freeRanges.erase(it);
+			}
+			this->used += p_count;
+			return true;
+		}
+		return false;
+	}
+
+	void free(uint32_t p_offset, uint32_t p_count) {
+		if (p_count == 0) {
+			return;
+		}
+
+		auto next = std::lower_bound(this->freeRanges.begin(), this->freeRanges.end(), p_offset, [](const Range& range, uint32_t offset) {
+			return range.offset < offset;
+		});
+		auto it = this->freeRanges.insert(next, {p_offset, p_count});
+
+		/* Merge with the following range, then with the preceding one */
+		auto following = it + 1;
+		if (following != this->freeRanges.end() && it->offset + it->count == following->offset) {
+			it->count += following->count;
+			it = this->freeRanges.erase(following) - 1;
+		}
+		if (it != this->freeRanges.begin()) {
+			auto preceding = it - 1;
+			if (preceding->offset + preceding->count == it->offset) {
+				preceding->count += it->count;
+				this->freeRanges.erase(it);
+			}
+		}
+
+		this->used -= p_count;
+	}
+
+	uint32_t getCapacity() const {
+		return this->capacity;
+	}
+
+	uint32_t getUsed() const {
+		return this->used;
+	}
+
+	/* Size of the largest free range, the largest allocation that can succeed */
+	uint32_t largestFreeRange() const {
+		uint32_t largest = 0;
+		for (const Range& range : this->freeRanges) {
+			largest = std::max(largest, range.count);
+		}
+		return largest;
+	}
+
+private:
+
+	struct Range {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	uint32_t capacity = 0;
+	uint32_t used = 0;
+	/* Sorted by offset, never adjacent */
+	std::vector<Range> freeRanges;
+
+};
+
+/**
+ * @brief One large vertex buffer and one large index buffer shared by every mesh.
+ *
+ * A mesh only owns ranges of the two buffers, so a whole scene binds them once and draws every mesh
+ * with its firstIndex / vertexOffset. The buffers are created by the application, the pool only manages their space.
+ *
+ * Thread safe, meshes can be allocated from worker threads.
+*/
+template<typename V>
+class GeometryPool {
+
+public:
+
+	void init(VkBuffer p_vertexBuffer, uint32_t p_maxVertices, VkBuffer p_indexBuffer, uint32_t p_maxIndices) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->vertexBuffer = p_vertexBuffer;
+		this->indexBuffer = p_indexBuffer;
+		this->vertices.init(p_maxVertices);
+		this->indices.init(p_maxIndices);
+	}
+
+	/**
+	 * @throw std::runtime_error if the pool has no room left for the mesh.
+	*/
+	Mesh allocate(uint32_t p_vertexCount, uint32_t p_indexCount) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		Mesh mesh;
+		mesh.vertexCount = p_vertexCount;
+		mesh.indexCount = p_indexCount;
+
+		if (!this->vertices.allocate(p_vertexCount, mesh.firstVertex)) {
+			throw std::runtime_error("geometry pool out of vertex space!");
+		}
+		if (!this->indices.allocate(p_indexCount, mesh.firstIndex)) {
+			this->vertices.free(mesh.firstVertex, p_vertexCount);
+			throw std::runtime_error("geometry pool out of index space!");
+		}
+		return mesh;
+	}
+
+	/**
+	 * @brief Give the ranges of the mesh back. The GPU must be done with the draws using them.
+	*/
+	void free(const Mesh& p_mesh) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->vertices.free(p_mesh.firstVertex, p_mesh.vertexCount);
+		this->indices.free(p_mesh.firstIndex, p_mesh.indexCount);
+	}
+
+	/**
+	 * @brief Bind the shared vertex and index buffers, once for every mesh drawn afterwards.
+	*/
+	void bind(VkCommandBuffer p_commandBuffer) const {
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, &this->vertexBuffer, &offset);
+		vkCmdBindIndexBuffer(p_commandBuffer, this->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	static VkDeviceSize vertexByteOffset(const Mesh& p_mesh) {
+		return static_cast<VkDeviceSize>(p_mesh.firstVertex) * sizeof(V);
+	}
+
+	static VkDeviceSize indexByteOffset(const Mesh& p_mesh) {
+		return static_cast<VkDeviceSize>(p_mesh.firstIndex) * sizeof(uint32_t);
+	}
+
+	VkBuffer getVertexBuffer() const {
+		return this->vertexBuffer;
+	}
+
+	VkBuffer getIndexBuffer() const {
+		return this->indexBuffer;
+	}
+
+private:
+
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+
+	RangeAllocator vertices;
+	RangeAllocator indices;
+
+	std::mutex mutex;
+
+};
+
+#endif // GEOMETRY_POOL_HPP
@@ -4,12 +4,32 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+
+#include "thread_pool.hpp"
 
 enum class ImageFormat {
 	PPM_P6,
 	Unsupported
 };
 
+/*
+ * Result of one decode of a batch. If the decode failed, pixels is null and error holds the exception.
+ */
+struct DecodedImage {
+	std::string path;
+	uint8_t *pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	std::exception_ptr error;
+};
+
 class ImageLoader {
 
 public:
@@ -29,6 +49,67 @@ public:
 		delete[] buffer;
 	}
 
+	/*
+	 * Decode every image of paths concurrently on the pool.
+	 * An ImageLoader holds the file it is reading, so each task uses its own instance.
+	 * onImageReady is called on the calling thread, in completion order, as soon as each image is decoded,
+	 * so the caller can start uploading it while the others are still being read.
+	 * The callback owns the pixels and must release them with freeImage.
+	 */
+	static void loadImages(const std::vector<std::string>& paths, ThreadPool& pool, const std::function<void(DecodedImage&&)>& onImageReady) {
+		/* Owned by the tasks too: a task may still hold it after the caller has popped its result and returned */
+		struct Completions {
+			std::mutex mutex;
+			std::condition_variable condition;
+			std::queue<DecodedImage> images;
+		};
+		std::shared_ptr<Completions> completions = std::make_shared<Completions>();
+
+		for (const std::string& path : paths) {
+			pool.submit([completions, path] {
+				DecodedImage image;
+				image.path = path;
+				try {
+					ImageLoader imageLoader;
+					image.pixels = imageLoader.loadImage(path, &image.width, &image.height);
+				} catch (...) {
+					image.error = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(completions->mutex);
+				completions->images.push(std::move(image));
+				completions->condition.notify_one();
+			});
+		}
+
+		/* Every result is popped, even after a failing callback, so that no pixels are leaked */
+		std::exception_ptr callbackError;
+		for (size_t i = 0; i < paths.size(); i++) {
+			DecodedImage image;
+			{
+				std::unique_lock<std::mutex> lock(completions->mutex);
+				completions->condition.wait(lock, [&] { return !completions->images.empty(); });
+				image = std::move(completions->images.front());
+				completions->images.pop();
+			}
+
+			/* After a failing callback, keep draining the remaining results but only free them */
+			if (callbackError) {
+				delete[] image.pixels;
+				continue;
+			}
+			try {
+				onImageReady(std::move(image));
+			} catch (...) {
+				callbackError = std::current_exception();
+			}
+		}
+
+		if (callbackError) {
+			std::rethrow_exception(callbackError);
+		}
+	}
+
 private:
 
 	std::ifstream file;
@@ -0,0 +1,138 @@
+#ifndef INDIRECT_DRAW_LIST_HPP
+#define INDIRECT_DRAW_LIST_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+/**
+ * @brief Per-frame lists of VkDrawIndexedIndirectCommand and of the data of each draw, in persistently mapped buffers.
+ *
+ * Like the uniform arena, both buffers are split in one region per frame in flight:
+ * 	- the indirect buffer region holds the draw count (read by vkCmdDrawIndexedIndirectCount) followed by the commands,
+ * 	- the draw data region holds one D per command, bound as a dynamic storage buffer.
+ *
+ * The firstInstance of each command is the index of its draw data, so the vertex shader finds it with gl_InstanceIndex.
+ * A region is reused by beginFrame() only once the GPU is done with the frame which last used it.
+*/
+template<typename D>
+class IndirectDrawList {
+
+public:
+
+	/* The count is padded so the commands stay aligned like the structure */
+	static const VkDeviceSize COUNT_SIZE = 16;
+
+	static VkDeviceSize commandRegionSize(uint32_t p_maxDraws) {
+		return COUNT_SIZE + static_cast<VkDeviceSize>(p_maxDraws) * sizeof(VkDrawIndexedIndirectCommand);
+	}
+
+	static VkDeviceSize drawDataRegionSize(uint32_t p_maxDraws, VkDeviceSize p_minOffsetAlignment) {
+		VkDeviceSize alignment = p_minOffsetAlignment > 0 ? p_minOffsetAlignment : 1;
+		VkDeviceSize size = static_cast<VkDeviceSize>(p_maxDraws) * sizeof(D);
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	void init(VkBuffer p_commandBuffer, void* p_commandMapped, VkBuffer p_drawDataBuffer, void* p_drawDataMapped, uint32_t p_maxDraws, uint32_t p_frameCount, VkDeviceSize p_minStorageOffsetAlignment) {
+		this->commandBuffer = p_commandBuffer;
+		this->commandMapped = static_cast<char*>(p_commandMapped);
+		this->drawDataBuffer = p_drawDataBuffer;
+		this->drawDataMapped = static_cast<char*>(p_drawDataMapped);
+		this->maxDraws = p_maxDraws;
+		this->frameCount = p_frameCount;
+		this->commandRegion = commandRegionSize(p_maxDraws);
+		this->drawDataRegion = drawDataRegionSize(p_maxDraws, p_minStorageOffsetAlignment);
+
+		this->frame = 0;
+		this->count = 0;
+	}
+
+	/**
+	 * @brief Start writing the draws of the frame in its regions, dropping what they held.
+	*/
+	void beginFrame(uint32_t p_frameIndex) {
+		this->frame = p_frameIndex % this->frameCount;
+		this->count = 0;
+		this->writeCount();
+	}
+
+	/**
+	 * @brief Add a draw of the mesh with p_data, return its index in the frame.
+	 *
+	 * @throw std::runtime_error if the list of the frame is full.
+	*/
+	uint32_t push(uint32_t p_indexCount, uint32_t p_firstIndex, int32_t p_vertexOffset, const D& p_data) {
+		if (this->count >= this->maxDraws) {
+			throw std::runtime_error("indirect draw list full for this frame!");
+		}
+
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = p_indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = p_firstIndex;
+		command.vertexOffset = p_vertexOffset;
+		command.firstInstance = this->count;
+
+		memcpy(this->commandMapped + this->commandOffset() + static_cast<VkDeviceSize>(this->count) * sizeof(VkDrawIndexedIndirectCommand), &command, sizeof(command));
+		memcpy(this->drawDataMapped + this->drawDataOffset() + static_cast<VkDeviceSize>(this->count) * sizeof(D), &p_data, sizeof(D));
+
+		this->count++;
+		this->writeCount();
+		return this->count - 1;
+	}
+
+	VkBuffer getCommandBuffer() const {
+		return this->commandBuffer;
+	}
+
+	VkBuffer getDrawDataBuffer() const {
+		return this->drawDataBuffer;
+	}
+
+	/* Offset of the draw count of the current frame in the command buffer */
+	VkDeviceSize countOffset() const {
+		return static_cast<VkDeviceSize>(this->frame) * this->commandRegion;
+	}
+
+	/* Offset of the first command of the current frame in the command buffer */
+	VkDeviceSize commandOffset() const {
+		return this->countOffset() + COUNT_SIZE;
+	}
+
+	/* Dynamic offset of the draw data of the current frame */
+	VkDeviceSize drawDataOffset() const {
+		return static_cast<VkDeviceSize>(this->frame) * this->drawDataRegion;
+	}
+
+	uint32_t drawCount() const {
+		return this->count;
+	}
+
+	uint32_t getMaxDraws() const {
+		return this->maxDraws;
+	}
+
+private:
+
+	VkBuffer commandBuffer = VK_NULL_HANDLE;
+	char* commandMapped = nullptr;
+	VkBuffer drawDataBuffer = VK_NULL_HANDLE;
+	char* drawDataMapped = nullptr;
+
+	uint32_t maxDraws = 0;
+	uint32_t frameCount = 1;
+	VkDeviceSize commandRegion = 0;
+	VkDeviceSize drawDataRegion = 0;
+
+	uint32_t frame = 0;
+	uint32_t count = 0;
+
+	void writeCount() {
+		memcpy(this->commandMapped + this->countOffset(), &this->count, sizeof(this->count));
+	}
+
+};
+
+#endif // INDIRECT_DRAW_LIST_HPP
@@ -0,0 +1,714 @@
+#ifndef MEMORY_ALLOCATOR_HPP
+#define MEMORY_ALLOCATOR_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+/*
+ * Instead of calling vkAllocateMemory for every buffer and image, the allocator takes large blocks
+ * of device memory per memory type and splits them among many resources using the offset parameter
+ * of vkBindBufferMemory / vkBindImageMemory.
+ *
+ * Two strategies are available for the blocks:
+ * 	Buddy: general purpose, free in any order, sizes are rounded up to a power of two.
+ * 	Linear: bump allocation for short lived data (e.g. staging), space is reclaimed from the top of the block.
+ */
+
+enum class AllocationStrategy {
+	Buddy,
+	Linear
+};
+
+/*
+ * Buffers and linear images must not share a bufferImageGranularity page with optimal images.
+ */
+enum class ResourceTiling {
+	Linear,
+	Optimal
+};
+
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	/* Pointer to the first byte of the allocation if the memory is host visible, nullptr otherwise */
+	void* mapped = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	/* Passed back to the defragmentation callback to find the owner of the allocation */
+	void* userData = nullptr;
+	/* Caller defined category of the allocation (e.g. vertex, texture), counted by tagUsage() */
+	uint32_t tag = 0;
+
+	bool dedicated = false;
+	AllocationStrategy strategy = AllocationStrategy::Buddy;
+};
+
+struct MemoryStatistics {
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	/* Bytes obtained from vkAllocateMemory */
+	VkDeviceSize blockBytes = 0;
+	/* Bytes handed out to resources, including the alignment and rounding padding */
+	VkDeviceSize allocatedBytes = 0;
+	uint32_t freeRangeCount = 0;
+	VkDeviceSize largestFreeRange = 0;
+
+	/* 0 when all the free space is contiguous, close to 1 when it is scattered in small ranges */
+	float fragmentation() const {
+		VkDeviceSize freeBytes = this->blockBytes - this->allocatedBytes;
+		if (freeBytes == 0) {
+			return 0.0f;
+		}
+		return 1.0f - static_cast<float>(this->largestFreeRange) / static_cast<float>(freeBytes);
+	}
+
+	void add(const MemoryStatistics& other) {
+		this->blockCount += other.blockCount;
+		this->allocationCount += other.allocationCount;
+		this->dedicatedAllocationCount += other.dedicatedAllocationCount;
+		this->blockBytes += other.blockBytes;
+		this->allocatedBytes += other.allocatedBytes;
+		this->freeRangeCount += other.freeRangeCount;
+		this->largestFreeRange = std::max(this->largestFreeRange, other.largestFreeRange);
+	}
+};
+
+/* Live allocations of one tag */
+struct TagUsage {
+	uint32_t allocationCount = 0;
+	VkDeviceSize bytes = 0;
+};
+
+struct DefragmentationResult {
+	uint32_t moveCount = 0;
+	VkDeviceSize bytesMoved = 0;
+	uint32_t blocksFreed = 0;
+};
+
+/**
+ * @brief Offsets bookkeeping of a memory block, independent of Vulkan.
+*/
+class BlockMetadata {
+
+public:
+
+	virtual ~BlockMetadata() = default;
+
+	/**
+	 * @brief Reserve a range and return its offset in p_offset. p_reservedSize receives the real size reserved (at least p_size).
+	 *
+	 * @return false if there is no range big enough.
+	*/
+	virtual bool allocate(VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize& p_offset, VkDeviceSize& p_reservedSize) = 0;
+	virtual void free(VkDeviceSize p_offset) = 0;
+
+	virtual VkDeviceSize largestFreeRange() const = 0;
+	virtual uint32_t freeRangeCount() const = 0;
+
+};
+
+/**
+ * @brief Binary buddy allocator: the block is recursively split in halves, freed halves merge back with their buddy.
+*/
+class BuddyMetadata: public BlockMetadata {
+
+public:
+
+	/* Smallest range handed out, below that the free lists become expensive for no gain */
+	static constexpr VkDeviceSize MIN_NODE_SIZE = 256;
+
+	BuddyMetadata(VkDeviceSize p_size) {
+		/* Only the largest power of two fitting in the block is usable */
+		this->maxOrder = 0;
+		while ((MIN_NODE_SIZE << (this->maxOrder + 1)) <= p_size) {
+			this->maxOrder++;
+		}
+		this->freeLists.resize(this->maxOrder + 1);
+		this->freeLists[this->maxOrder].insert(0);
+	}
+
+	bool allocate(VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize& p_offset, VkDeviceSize& p_reservedSize) override {
+		/* A node is aligned on its own size, so asking for a node as big as the alignment is enough */
+		uint32_t order = this->orderOf(std::max(p_size, p_alignment));
+		if (order > this->maxOrder) {
+			return false;
+		}
+
+		/* Find the smallest free node that fits, then split it down to the requested order */
+		uint32_t current = order;
+		while (current <= this->maxOrder && this->freeLists[current].empty()) {
+			current++;
+		}
+		if (current > this->maxOrder) {
+			return false;
+		}
+
+		VkDeviceSize offset = *this->freeLists[current].begin();
+		this->freeLists[current].erase(this->freeLists[current].begin());
+
+		while (current > order) {
+			current--;
+			this->freeLists[current].insert(offset + this->nodeSize(current));
+		}
+
+		this->allocated[offset] = order;
+		p_offset = offset;
+		p_reservedSize = this->nodeSize(order);
+		return true;
+	}
+
+	void free(VkDeviceSize p_offset) override {
+		auto it = this->allocated.find(p_offset);
+		if (it == this->allocated.end()) {
+			throw std::invalid_argument("freeing an offset which is not allocated!");
+		}
+		uint32_t order = it->second;
+		this->allocated.erase(it);
+
+		/* Merge with the buddy as long as it is free */
+		VkDeviceSize offset = p_offset;
+		while (order < this->maxOrder) {
+			VkDeviceSize buddy = offset ^ this->nodeSize(order);
+			auto buddyIt = this->freeLists[order].find(buddy);
+			if (buddyIt == this->freeLists[order].end()) {
+				break;
+			}
+			this->freeLists[order].erase(buddyIt);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+		this->freeLists[order].insert(offset);
+	}
+
+	VkDeviceSize largestFreeRange() const override {
+		for (uint32_t order = this->maxOrder + 1; order-- > 0;) {
+			if (!this->freeLists[order].empty()) {
+				return this->nodeSize(order);
+			}
+		}
+		return 0;
+	}
+
+	uint32_t freeRangeCount() const override {
+		size_t count = 0;
+		for (const auto& freeList : this->freeLists) {
+			count += freeList.size();
+		}
+		return static_cast<uint32_t>(count);
+	}
+
+private:
+
+	uint32_t maxOrder;
+	/* freeLists[order] holds the offsets of the free nodes of size MIN_NODE_SIZE << order */
+	std::vector<std::set<VkDeviceSize>> freeLists;
+	std::map<VkDeviceSize, uint32_t> allocated;
+
+	VkDeviceSize nodeSize(uint32_t p_order) const {
+		return MIN_NODE_SIZE << p_order;
+	}
+
+	uint32_t orderOf(VkDeviceSize p_size) const {
+		uint32_t order = 0;
+		while (this->nodeSize(order) < p_size) {
+			order++;
+		}
+		return order;
+	}
+
+};
+
+/**
+ * @brief Bump allocator: ranges are taken at the top of the block, space is given back when the top ranges are freed.
+*/
+class LinearMetadata: public BlockMetadata {
+
+public:
+
+	LinearMetadata(VkDeviceSize p_size): size(p_size) {}
+
+	bool allocate(VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize& p_offset, VkDeviceSize& p_reservedSize) override {
+		VkDeviceSize offset = alignUp(this->top, p_alignment);
+		if (offset + p_size > this->size) {
+			return false;
+		}
+
+		this->allocated[offset] = p_size;
+		this->top = offset + p_size;
+		p_offset = offset;
+		p_reservedSize = p_size;
+		return true;
+	}
+
+	void free(VkDeviceSize p_offset) override {
+		if (this->allocated.erase(p_offset) == 0) {
+			throw std::invalid_argument("freeing an offset which is not allocated!");
+		}
+		/* Everything above the last live range is free again */
+		this->top = this->allocated.empty() ? 0 : this->allocated.rbegin()->first + this->allocated.rbegin()->second;
+	}
+
+	VkDeviceSize largestFreeRange() const override {
+		return this->size - this->top;
+	}
+
+	uint32_t freeRangeCount() const override {
+		return this->top < this->size ? 1 : 0;
+	}
+
+	static VkDeviceSize alignUp(VkDeviceSize p_value, VkDeviceSize p_alignment) {
+		return (p_value + p_alignment - 1) / p_alignment * p_alignment;
+	}
+
+private:
+
+	VkDeviceSize size;
+	VkDeviceSize top = 0;
+	std::map<VkDeviceSize, VkDeviceSize> allocated;
+
+};
+
+/**
+ * @brief Sub-allocate buffers and images from large VkDeviceMemory blocks.
+ *
+ * Thread safe, all the public functions lock the allocator.
+*/
+class MemoryAllocator {
+
+public:
+
+	/* Move callback of defragment(): create a resource bound to p_destination, copy the content of p_source into it
+	 * and update the owner found with p_source.userData. Return false to keep the allocation where it is. */
+	typedef std::function<bool(const Allocation& p_source, const Allocation& p_destination)> MoveCallback;
+
+	MemoryAllocator() = default;
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	void init(VkPhysicalDevice p_physicalDevice, VkDevice p_device) {
+		this->device = p_device;
+
+		vkGetPhysicalDeviceMemoryProperties(p_physicalDevice, &this->memoryProperties);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(p_physicalDevice, &properties);
+		this->bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+		this->pools.clear();
+		this->pools.resize(this->memoryProperties.memoryTypeCount);
+		for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+			/* Small heaps (e.g. the 256 MiB device local and host visible heap) get smaller blocks */
+			VkDeviceSize heapSize = this->memoryProperties.memoryHeaps[this->memoryProperties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize blockSize = heapSize <= SMALL_HEAP_MAX_SIZE ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+			/* The buddy strategy only uses the largest power of two of a block */
+			this->pools[i].blockSize = BuddyMetadata::MIN_NODE_SIZE;
+			while (this->pools[i].blockSize * 2 <= blockSize) {
+				this->pools[i].blockSize *= 2;
+			}
+		}
+	}
+
+	/**
+	 * @brief Free all the blocks. Every allocation must have been freed before.
+	*/
+	void destroy() {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		for (MemoryPool& pool : this->pools) {
+			for (auto& block : pool.blocks) {
+				this->freeBlock(*block);
+			}
+			pool.blocks.clear();
+			pool.dedicatedMemories.clear();
+			pool.dedicatedCount = 0;
+			pool.dedicatedBytes = 0;
+		}
+		this->tags.clear();
+	}
+
+	/**
+	 * @brief Reserve memory of the given type for a resource with the given requirements.
+	 *
+	 * @throw std::runtime_error if the device is out of memory.
+	*/
+	Allocation allocate(const VkMemoryRequirements& p_requirements, uint32_t p_memoryTypeIndex, ResourceTiling p_tiling, AllocationStrategy p_strategy = AllocationStrategy::Buddy, void* p_userData = nullptr, uint32_t p_tag = 0) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		Allocation allocation = this->allocateLocked(p_requirements, p_memoryTypeIndex, p_tiling, p_strategy, p_userData, p_tag);
+
+		if (p_tag >= this->tags.size()) {
+			this->tags.resize(p_tag + 1);
+		}
+		this->tags[p_tag].allocationCount++;
+		this->tags[p_tag].bytes += allocation.size;
+		return allocation;
+	}
+
+	/**
+	 * @brief Give the range of an allocation back and reset it.
+	 *
+	 * @throw std::invalid_argument if the allocation is not live (e.g. a stale copy of an allocation already freed).
+	*/
+	void free(Allocation& p_allocation) {
+		if (p_allocation.memory == VK_NULL_HANDLE) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (p_allocation.memoryTypeIndex >= this->pools.size() || p_allocation.tag >= this->tags.size()) {
+			throw std::invalid_argument("freeing an allocation which does not belong to the allocator!");
+		}
+		MemoryPool& pool = this->pools[p_allocation.memoryTypeIndex];
+
+		if (p_allocation.dedicated) {
+			if (pool.dedicatedMemories.erase(p_allocation.memory) == 0) {
+				throw std::invalid_argument("freeing a dedicated allocation which is not allocated!");
+			}
+			vkFreeMemory(this->device, p_allocation.memory, nullptr);
+			pool.dedicatedCount--;
+			pool.dedicatedBytes -= p_allocation.size;
+			this->untag(p_allocation);
+			p_allocation = Allocation();
+			return;
+		}
+
+		auto blockIt = std::find_if(pool.blocks.begin(), pool.blocks.end(), [&](const std::unique_ptr<MemoryBlock>& block) {
+			return block->memory == p_allocation.memory;
+		});
+		if (blockIt == pool.blocks.end()) {
+			throw std::invalid_argument("freeing an allocation which does not belong to the allocator!");
+		}
+		MemoryBlock& block = **blockIt;
+
+		auto recordIt = block.allocations.find(p_allocation.offset);
+		if (recordIt == block.allocations.end()) {
+			throw std::invalid_argument("freeing an offset which is not allocated!");
+		}
+		block.allocatedBytes -= recordIt->second.reservedSize;
+		block.allocations.erase(recordIt);
+		block.metadata->free(p_allocation.offset);
+		this->untag(p_allocation);
+
+		/* Keep one empty block per memory type so that allocating and freeing in a loop does not hit vkAllocateMemory */
+		if (block.allocations.empty() && this->emptyBlockCount(pool) > 1) {
+			this->freeBlock(block);
+			pool.blocks.erase(blockIt);
+		}
+
+		p_allocation = Allocation();
+	}
+
+	/**
+	 * @brief Move allocations out of the least used blocks of every memory type, then release the blocks left empty.
+	 *
+	 * The caller must make sure the GPU does not use the moved resources anymore (e.g. call it after vkDeviceWaitIdle).
+	*/
+	DefragmentationResult defragment(const MoveCallback& p_move) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		DefragmentationResult result;
+
+		for (MemoryPool& pool : this->pools) {
+			if (pool.blocks.size() < 2) {
+				continue;
+			}
+
+			/* Empty the sparsest blocks first, into the densest ones */
+			std::vector<MemoryBlock*> blocks;
+			for (auto& block : pool.blocks) {
+				if (block->strategy == AllocationStrategy::Buddy) {
+					blocks.push_back(block.get());
+				}
+			}
+			std::sort(blocks.begin(), blocks.end(), [](const MemoryBlock* a, const MemoryBlock* b) {
+				return a->allocatedBytes < b->allocatedBytes;
+			});
+
+			for (size_t source = 0; source + 1 < blocks.size(); source++) {
+				MemoryBlock& sourceBlock = *blocks[source];
+
+				/* Copy the records since moving them modifies the map */
+				std::vector<std::pair<VkDeviceSize, AllocationRecord>> records(sourceBlock.allocations.begin(), sourceBlock.allocations.end());
+				for (const auto& [offset, record] : records) {
+					for (size_t destination = blocks.size() - 1; destination > source; destination--) {
+						Allocation newAllocation;
+						if (!this->allocateFromBlock(*blocks[destination], record.size, record.alignment, record.tiling, record.userData, record.tag, newAllocation)) {
+							continue;
+						}
+
+						Allocation oldAllocation = this->makeAllocation(sourceBlock, offset, record);
+						if (p_move(oldAllocation, newAllocation)) {
+							sourceBlock.allocatedBytes -= record.reservedSize;
+							sourceBlock.allocations.erase(offset);
+							sourceBlock.metadata->free(offset);
+							result.moveCount++;
+							result.bytesMoved += record.size;
+						} else {
+							/* Cancelled by the caller, give the new range back */
+							blocks[destination]->allocatedBytes -= blocks[destination]->allocations[newAllocation.offset].reservedSize;
+							blocks[destination]->allocations.erase(newAllocation.offset);
+							blocks[destination]->metadata->free(newAllocation.offset);
+						}
+						break;
+					}
+				}
+			}
+
+			/* Release the blocks emptied by the moves, keeping a single empty one */
+			for (auto it = pool.blocks.begin(); it != pool.blocks.end();) {
+				if ((*it)->allocations.empty() && this->emptyBlockCount(pool) > 1) {
+					this->freeBlock(**it);
+					it = pool.blocks.erase(it);
+					result.blocksFreed++;
+				} else {
+					it++;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * @brief Optimal images are padded to whole p_granularity pages, so no page is shared between them and a linear resource.
+	*/
+	static void padForGranularity(ResourceTiling p_tiling, VkDeviceSize p_granularity, VkDeviceSize& p_size, VkDeviceSize& p_alignment) {
+		if (p_tiling == ResourceTiling::Optimal) {
+			p_alignment = std::max(p_alignment, p_granularity);
+			p_size = LinearMetadata::alignUp(p_size, p_granularity);
+		}
+	}
+
+	MemoryStatistics statistics(uint32_t p_memoryTypeIndex) const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->poolStatistics(this->pools[p_memoryTypeIndex]);
+	}
+
+	MemoryStatistics totalStatistics() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		MemoryStatistics total;
+		for (const MemoryPool& pool : this->pools) {
+			total.add(this->poolStatistics(pool));
+		}
+		return total;
+	}
+
+	TagUsage tagUsage(uint32_t p_tag) const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return p_tag < this->tags.size() ? this->tags[p_tag] : TagUsage();
+	}
+
+	uint32_t memoryTypeCount() const {
+		return this->memoryProperties.memoryTypeCount;
+	}
+
+	/* Queried once by init(), so looking for a memory type does not query the driver each time */
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const {
+		return this->memoryProperties;
+	}
+
+private:
+
+	/* Blocks of heaps larger than 1 GiB */
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize SMALL_HEAP_MAX_SIZE = 1024ull * 1024 * 1024;
+
+	struct AllocationRecord {
+		VkDeviceSize size;
+		VkDeviceSize alignment;
+		VkDeviceSize reservedSize;
+		ResourceTiling tiling;
+		void* userData;
+		uint32_t tag;
+	};
+
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		uint32_t memoryTypeIndex = 0;
+		AllocationStrategy strategy = AllocationStrategy::Buddy;
+		std::unique_ptr<BlockMetadata> metadata;
+
+		std::map<VkDeviceSize, AllocationRecord> allocations;
+		VkDeviceSize allocatedBytes = 0;
+	};
+
+	struct MemoryPool {
+		VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+		std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		/* Memories of the live dedicated allocations, to reject freeing one twice */
+		std::set<VkDeviceMemory> dedicatedMemories;
+		uint32_t dedicatedCount = 0;
+		VkDeviceSize dedicatedBytes = 0;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize bufferImageGranularity = 1;
+
+	std::vector<MemoryPool> pools;
+	std::vector<TagUsage> tags;
+
+	mutable std::mutex mutex;
+
+	bool isHostVisible(uint32_t p_memoryTypeIndex) const {
+		return this->memoryProperties.memoryTypes[p_memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	VkDeviceMemory allocateMemory(VkDeviceSize p_size, uint32_t p_memoryTypeIndex, void** p_mapped) {
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = p_size;
+		allocInfo.memoryTypeIndex = p_memoryTypeIndex;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(this->device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate device memory!");
+		}
+
+		/* Host visible memory can only be mapped once, so it is mapped for its whole lifetime and shared by the sub-allocations */
+		*p_mapped = nullptr;
+		if (this->isHostVisible(p_memoryTypeIndex)) {
+			vkMapMemory(this->device, memory, 0, VK_WHOLE_SIZE, 0, p_mapped);
+		}
+
+		return memory;
+	}
+
+	Allocation allocateLocked(const VkMemoryRequirements& p_requirements, uint32_t p_memoryTypeIndex, ResourceTiling p_tiling, AllocationStrategy p_strategy, void* p_userData, uint32_t p_tag) {
+		VkDeviceSize size = p_requirements.size;
+		VkDeviceSize alignment = p_requirements.alignment;
+		padForGranularity(p_tiling, this->bufferImageGranularity, size, alignment);
+
+		MemoryPool& pool = this->pools[p_memoryTypeIndex];
+
+		/* Resources bigger than half a block would waste most of it, they get their own memory */
+		if (size > pool.blockSize / 2) {
+			return this->allocateDedicated(p_requirements.size, p_memoryTypeIndex, p_strategy, p_userData, p_tag);
+		}
+
+		Allocation allocation;
+		for (auto& block : pool.blocks) {
+			if (block->strategy == p_strategy && this->allocateFromBlock(*block, size, alignment, p_tiling, p_userData, p_tag, allocation)) {
+				return allocation;
+			}
+		}
+
+		pool.blocks.push_back(this->createBlock(p_memoryTypeIndex, pool.blockSize, p_strategy));
+		if (!this->allocateFromBlock(*pool.blocks.back(), size, alignment, p_tiling, p_userData, p_tag, allocation)) {
+			throw std::runtime_error("failed to sub-allocate from a new memory block!");
+		}
+		return allocation;
+	}
+
+	std::unique_ptr<MemoryBlock> createBlock(uint32_t p_memoryTypeIndex, VkDeviceSize p_size, AllocationStrategy p_strategy) {
+		auto block = std::make_unique<MemoryBlock>();
+		block->memory = this->allocateMemory(p_size, p_memoryTypeIndex, &block->mapped);
+		block->size = p_size;
+		block->memoryTypeIndex = p_memoryTypeIndex;
+		block->strategy = p_strategy;
+		if (p_strategy == AllocationStrategy::Linear) {
+			block->metadata = std::make_unique<LinearMetadata>(p_size);
+		} else {
+			block->metadata = std::make_unique<BuddyMetadata>(p_size);
+		}
+		return block;
+	}
+
+	void freeBlock(MemoryBlock& p_block) {
+		if (p_block.mapped != nullptr) {
+			vkUnmapMemory(this->device, p_block.memory);
+		}
+		vkFreeMemory(this->device, p_block.memory, nullptr);
+	}
+
+	Allocation allocateDedicated(VkDeviceSize p_size, uint32_t p_memoryTypeIndex, AllocationStrategy p_strategy, void* p_userData, uint32_t p_tag) {
+		Allocation allocation;
+		allocation.memory = this->allocateMemory(p_size, p_memoryTypeIndex, &allocation.mapped);
+		allocation.offset = 0;
+		allocation.size = p_size;
+		allocation.memoryTypeIndex = p_memoryTypeIndex;
+		allocation.userData = p_userData;
+		allocation.tag = p_tag;
+		allocation.dedicated = true;
+		allocation.strategy = p_strategy;
+
+		this->pools[p_memoryTypeIndex].dedicatedMemories.insert(allocation.memory);
+		this->pools[p_memoryTypeIndex].dedicatedCount++;
+		this->pools[p_memoryTypeIndex].dedicatedBytes += p_size;
+		return allocation;
+	}
+
+	bool allocateFromBlock(MemoryBlock& p_block, VkDeviceSize p_size, VkDeviceSize p_alignment, ResourceTiling p_tiling, void* p_userData, uint32_t p_tag, Allocation& p_allocation) {
+		VkDeviceSize offset;
+		VkDeviceSize reservedSize;
+		if (!p_block.metadata->allocate(p_size, p_alignment, offset, reservedSize)) {
+			return false;
+		}
+
+		AllocationRecord record{p_size, p_alignment, reservedSize, p_tiling, p_userData, p_tag};
+		p_block.allocations[offset] = record;
+		p_block.allocatedBytes += reservedSize;
+
+		p_allocation = this->makeAllocation(p_block, offset, record);
+		return true;
+	}
+
+	Allocation makeAllocation(const MemoryBlock& p_block, VkDeviceSize p_offset, const AllocationRecord& p_record) const {
+		Allocation allocation;
+		allocation.memory = p_block.memory;
+		allocation.offset = p_offset;
+		allocation.size = p_record.size;
+		allocation.mapped = p_block.mapped != nullptr ? static_cast<char*>(p_block.mapped) + p_offset : nullptr;
+		allocation.memoryTypeIndex = p_block.memoryTypeIndex;
+		allocation.userData = p_record.userData;
+		allocation.tag = p_record.tag;
+		allocation.dedicated = false;
+		allocation.strategy = p_block.strategy;
+		return allocation;
+	}
+
+	void untag(const Allocation& p_allocation) {
+		this->tags[p_allocation.tag].allocationCount--;
+		this->tags[p_allocation.tag].bytes -= p_allocation.size;
+	}
+
+	size_t emptyBlockCount(const MemoryPool& p_pool) const {
+		return std::count_if(p_pool.blocks.begin(), p_pool.blocks.end(), [](const std::unique_ptr<MemoryBlock>& block) {
+			return block->allocations.empty();
+		});
+	}
+
+	MemoryStatistics poolStatistics(const MemoryPool& p_pool) const {
+		MemoryStatistics stats;
+		for (const auto& block : p_pool.blocks) {
+			stats.blockCount++;
+			stats.allocationCount += static_cast<uint32_t>(block->allocations.size());
+			stats.blockBytes += block->size;
+			stats.allocatedBytes += block->allocatedBytes;
+			stats.freeRangeCount += block->metadata->freeRangeCount();
+			stats.largestFreeRange = std::max(stats.largestFreeRange, block->metadata->largestFreeRange());
+		}
+		stats.allocationCount += p_pool.dedicatedCount;
+		stats.dedicatedAllocationCount = p_pool.dedicatedCount;
+		stats.blockBytes += p_pool.dedicatedBytes;
+		stats.allocatedBytes += p_pool.dedicatedBytes;
+		return stats;
+	}
+
+};
+
+#endif // MEMORY_ALLOCATOR_HPP
@@ -0,0 +1,198 @@
+#ifndef MEMORY_TELEMETRY_HPP
+#define MEMORY_TELEMETRY_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+
+#include "memory_allocator.hpp"
+
+/*
+ * What an allocation is used for, passed as the tag of the MemoryAllocator allocations.
+ */
+enum class MemoryCategory: uint32_t {
+	Other,
+	Vertex,
+	Index,
+	Texture,
+	Uniform,
+	Attachment,
+	Staging,
+	Count
+};
+
+inline const char* memoryCategoryName(MemoryCategory p_category) {
+	switch (p_category) {
+		case MemoryCategory::Vertex: return "vertex";
+		case MemoryCategory::Index: return "index";
+		case MemoryCategory::Texture: return "texture";
+		case MemoryCategory::Uniform: return "uniform";
+		case MemoryCategory::Attachment: return "attachment";
+		case MemoryCategory::Staging: return "staging";
+		default: return "other";
+	}
+}
+
+inline MemoryCategory bufferMemoryCategory(VkBufferUsageFlags p_usage) {
+	if (p_usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return MemoryCategory::Vertex;
+	if (p_usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return MemoryCategory::Index;
+	if (p_usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return MemoryCategory::Uniform;
+	if (p_usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return MemoryCategory::Staging;
+	return MemoryCategory::Other;
+}
+
+inline MemoryCategory imageMemoryCategory(VkImageUsageFlags p_usage) {
+	if (p_usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) return MemoryCategory::Attachment;
+	if (p_usage & VK_IMAGE_USAGE_SAMPLED_BIT) return MemoryCategory::Texture;
+	return MemoryCategory::Other;
+}
+
+struct HeapBudget {
+	VkDeviceSize size = 0;
+	/* Bytes used in the heap, by this process if the budget comes from the driver, by the allocator otherwise */
+	VkDeviceSize usage = 0;
+	/* Bytes this process can use before allocations may fail or degrade performance */
+	VkDeviceSize budget = 0;
+	bool deviceLocal = false;
+};
+
+/**
+ * @brief Report the use of device memory: per heap usage and budget, bytes per category and allocator statistics.
+ *
+ * The budget comes from VK_EXT_memory_budget when the device supports it. Otherwise the usage is what the allocator
+ * got from vkAllocateMemory and the budget is the size of the heap, which ignores the other processes.
+*/
+class MemoryTelemetry {
+
+public:
+
+	void init(VkPhysicalDevice p_physicalDevice, bool p_memoryBudgetSupported) {
+		this->physicalDevice = p_physicalDevice;
+		this->memoryBudgetSupported = p_memoryBudgetSupported;
+	}
+
+	bool hasDriverBudget() const {
+		return this->memoryBudgetSupported;
+	}
+
+	/**
+	 * @brief Query the usage and budget of every heap. The driver budget is refreshed at each call, so avoid calling it every frame.
+	*/
+	std::vector<HeapBudget> heapBudgets(const MemoryAllocator& p_allocator) const {
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = p_allocator.getMemoryProperties();
+
+		std::vector<HeapBudget> heaps(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+			heaps[i].size = memoryProperties.memoryHeaps[i].size;
+			heaps[i].budget = memoryProperties.memoryHeaps[i].size;
+			heaps[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+		}
+
+		if (this->memoryBudgetSupported) {
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+			budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+			VkPhysicalDeviceMemoryProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties2.pNext = &budgetProperties;
+			vkGetPhysicalDeviceMemoryProperties2(this->physicalDevice, &properties2);
+
+			for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+				heaps[i].usage = budgetProperties.heapUsage[i];
+				heaps[i].budget = budgetProperties.heapBudget[i];
+			}
+		} else {
+			for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+				heaps[memoryProperties.memoryTypes[type].heapIndex].usage += p_allocator.statistics(type).blockBytes;
+			}
+		}
+
+		return heaps;
+	}
+
+	/**
+	 * @brief Write the heaps, the categories and the allocator statistics of every memory type as JSON.
+	*/
+	void dumpJson(std::ostream& p_out, const MemoryAllocator& p_allocator) const {
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = p_allocator.getMemoryProperties();
+
+		p_out << "{\n";
+		p_out << "\t\"budgetSource\": \"" << (this->memoryBudgetSupported ? "VK_EXT_memory_budget" : "allocator") << "\",\n";
+
+		std::vector<HeapBudget> heaps = this->heapBudgets(p_allocator);
+		p_out << "\t\"heaps\": [\n";
+		for (size_t i = 0; i < heaps.size(); i++) {
+			p_out << "\t\t{\"index\": " << i
+				<< ", \"deviceLocal\": " << (heaps[i].deviceLocal ? "true" : "false")
+				<< ", \"size\": " << heaps[i].size
+				<< ", \"usage\": " << heaps[i].usage
+				<< ", \"budget\": " << heaps[i].budget
+				<< "}" << (i + 1 < heaps.size() ? "," : "") << "\n";
+		}
+		p_out << "\t],\n";
+
+		p_out << "\t\"categories\": {\n";
+		for (uint32_t c = 0; c < static_cast<uint32_t>(MemoryCategory::Count); c++) {
+			TagUsage usage = p_allocator.tagUsage(c);
+			p_out << "\t\t\"" << memoryCategoryName(static_cast<MemoryCategory>(c)) << "\": {"
+				<< "\"allocations\": " << usage.allocationCount
+				<< ", \"bytes\": " << usage.bytes
+				<< "}" << (c + 1 < static_cast<uint32_t>(MemoryCategory::Count) ? "," : "") << "\n";
+		}
+		p_out << "\t},\n";
+
+		p_out << "\t\"memoryTypes\": [\n";
+		bool first = true;
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+			MemoryStatistics stats = p_allocator.statistics(type);
+			if (stats.blockCount == 0 && stats.dedicatedAllocationCount == 0) {
+				continue;
+			}
+			p_out << (first ? "" : ",\n");
+			first = false;
+			p_out << "\t\t{\"index\": " << type
+				<< ", \"heap\": " << memoryProperties.memoryTypes[type].heapIndex
+				<< ", \"propertyFlags\": " << memoryProperties.memoryTypes[type].propertyFlags
+				<< ", " << statisticsJson(stats) << "}";
+		}
+		p_out << (first ? "" : "\n") << "\t],\n";
+
+		p_out << "\t\"total\": {" << statisticsJson(p_allocator.totalStatistics()) << "}\n";
+		p_out << "}\n";
+	}
+
+	/**
+	 * @throw std::runtime_error if the file cannot be written.
+	*/
+	void dumpJson(const std::string& p_path, const MemoryAllocator& p_allocator) const {
+		std::ofstream file(p_path);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open memory telemetry file: " + p_path);
+		}
+		this->dumpJson(file, p_allocator);
+	}
+
+private:
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	bool memoryBudgetSupported = false;
+
+	static std::string statisticsJson(const MemoryStatistics& p_stats) {
+		return "\"blocks\": " + std::to_string(p_stats.blockCount)
+			+ ", \"allocations\": " + std::to_string(p_stats.allocationCount)
+			+ ", \"dedicatedAllocations\": " + std::to_string(p_stats.dedicatedAllocationCount)
+			+ ", \"blockBytes\": " + std::to_string(p_stats.blockBytes)
+			+ ", \"allocatedBytes\": " + std::to_string(p_stats.allocatedBytes)
+			+ ", \"freeRanges\": " + std::to_string(p_stats.freeRangeCount)
+			+ ", \"largestFreeRange\": " + std::to_string(p_stats.largestFreeRange)
+			+ ", \"fragmentation\": " + std::to_string(p_stats.fragmentation());
+	}
+
+};
+
+#endif // MEMORY_TELEMETRY_HPP
@@ -14,6 +14,9 @@ private:
 	Vertices vertices;
 	std::vector<uint32_t> indices;
 
+	/* Copies of the object drawn with a single instanced draw call, none means the object is drawn once */
+	std::vector<InstanceData> instances;
+
 	ft::vec3 baricenter;
 
 public:
@@ -29,6 +32,7 @@ public:
 	Object(Object&& other):
 		vertices(std::move(other.vertices)),
 		indices(std::move(other.indices)),
+		instances(std::move(other.instances)),
 		baricenter(other.baricenter),
 		position(other.position),
 		rotation(other.rotation),
@@ -39,6 +43,7 @@ public:
 		if (this != &other) {
 			this->vertices = std::move(other.vertices);
 			this->indices = std::move(other.indices);
+			this->instances = std::move(other.instances);
 			this->position = other.position;
 			this->rotation = other.rotation;
 			this->scale = other.scale;
@@ -70,6 +75,37 @@ public:
 		return this->indices;
 	}
 
+	/**
+	 * @brief Add a copy of the object, p_model is applied before the model of the object.
+	*/
+	void addInstance(const ft::mat4& p_model, const ft::vec4& p_color = ft::vec4(1.0f, 1.0f, 1.0f, 1.0f), uint32_t p_textureIndex = 0) {
+		InstanceData instance;
+		instance.model = p_model;
+		instance.color = p_color;
+		instance.textureIndex = p_textureIndex;
+		this->instances.push_back(instance);
+	}
+
+	void clearInstances() {
+		this->instances.clear();
+	}
+
+	void reserveInstances(size_t p_count) {
+		this->instances.reserve(p_count);
+	}
+
+	const std::vector<InstanceData>& getInstances() const {
+		return this->instances;
+	}
+
+	std::vector<InstanceData>& getInstances() {
+		return this->instances;
+	}
+
+	uint32_t instanceCount() const {
+		return static_cast<uint32_t>(this->instances.size());
+	}
+
 	const ft::vec3& getBaricenter() const {
 		return this->baricenter;
 	}
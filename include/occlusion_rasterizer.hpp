@@ -0,0 +1,363 @@
+#ifndef OCCLUSION_RASTERIZER_HPP
+#define OCCLUSION_RASTERIZER_HPP
+
+#include <ft_glm/ft_glm.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__) || defined(__SSE__)
+# include <immintrin.h>
+#endif
+
+#include "frustum.hpp"
+
+/* Coarse triangle mesh standing for an object when it hides others, it must stay inside the drawn mesh */
+struct OccluderMesh {
+	std::vector<ft::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	/* Box between p_min and p_max, e.g. the inside of a wall */
+	static OccluderMesh box(const ft::vec3& p_min, const ft::vec3& p_max) {
+		OccluderMesh mesh;
+		for (uint32_t corner = 0; corner < 8; corner++) {
+			mesh.positions.push_back(ft::vec3(
+				corner & 1 ? p_max[0] : p_min[0],
+				corner & 2 ? p_max[1] : p_min[1],
+				corner & 4 ? p_max[2] : p_min[2]
+			));
+		}
+		/* Two triangles per face, the rasterizer does not cull back faces so the winding does not matter */
+		mesh.indices = {
+			0, 1, 3, 0, 3, 2,	4, 5, 7, 4, 7, 6,
+			0, 1, 5, 0, 5, 4,	2, 3, 7, 2, 7, 6,
+			0, 2, 6, 0, 6, 4,	1, 3, 7, 1, 7, 5
+		};
+		return mesh;
+	}
+};
+
+/**
+ * @brief Low resolution depth buffer filled on the CPU with occluder meshes, to cull the objects they hide before recording any draw.
+ *
+ * The buffer is split in tiles of 8x4 pixels, one row of a tile is tested and written 8 (AVX) or 4 (SSE) pixels at a time.
+ * Each tile also keeps its farthest depth: triangles behind it are skipped and objects in front of it are visible
+ * without looking at the pixels.
+ *
+ * The depths are conservative, an object is only culled if it is behind the occluders:
+ * 	- the covered pixels get the farthest depth of the triangle,
+ * 	- triangles reaching behind the camera are not rasterized,
+ * 	- objects are tested with the screen rectangle and the nearest depth of their bounding sphere.
+ *
+ * Like masked occlusion culling, the coverage follows the pixel centers so the triangles of a mesh leave no gap between them.
+ * An object seen only through the uncovered part of a pixel on the silhouette of an occluder could be culled,
+ * which is why the rectangle of the objects is grown by a pixel on each side.
+ *
+ * The depth is the clip space w, the distance along the view direction, so it is the same for any projection.
+*/
+class OcclusionRasterizer {
+
+public:
+
+	static const uint32_t TILE_WIDTH = 8;
+	static const uint32_t TILE_HEIGHT = 4;
+
+	/* Vertices with a smaller clip w are considered behind the camera */
+	static constexpr float MIN_W = 1e-4f;
+
+	/**
+	 * @brief Size of the buffer in pixels, rounded up to whole tiles.
+	*/
+	void resize(uint32_t p_width, uint32_t p_height) {
+		this->tilesX = std::max(1u, (p_width + TILE_WIDTH - 1) / TILE_WIDTH);
+		this->tilesY = std::max(1u, (p_height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		this->width = this->tilesX * TILE_WIDTH;
+		this->height = this->tilesY * TILE_HEIGHT;
+		this->depth.resize(static_cast<size_t>(this->width) * this->height);
+		this->tileMaxDepth.resize(static_cast<size_t>(this->tilesX) * this->tilesY);
+		this->clear();
+	}
+
+	/**
+	 * @brief Nothing hides anything until the occluders of the frame are rasterized.
+	*/
+	void clear() {
+		std::fill(this->depth.begin(), this->depth.end(), std::numeric_limits<float>::max());
+		std::fill(this->tileMaxDepth.begin(), this->tileMaxDepth.end(), std::numeric_limits<float>::max());
+	}
+
+	/* Write the rows one pixel at a time, the reference of the SIMD paths */
+	void setSimd(bool p_simd) {
+		this->simd = p_simd;
+	}
+
+	/**
+	 * @brief Rasterize every triangle of p_mesh, p_mvp being projection * view * model.
+	*/
+	void rasterize(const OccluderMesh& p_mesh, const ft::mat4& p_mvp) {
+		/* Screen x, y and clip w of each vertex */
+		this->screenVertices.resize(p_mesh.positions.size());
+		for (size_t i = 0; i < p_mesh.positions.size(); i++) {
+			float clip[4];
+			transform(p_mvp, p_mesh.positions[i], clip);
+
+			ScreenVertex& vertex = this->screenVertices[i];
+			vertex.w = clip[3];
+			if (clip[3] > MIN_W) {
+				vertex.x = (clip[0] / clip[3] * 0.5f + 0.5f) * static_cast<float>(this->width);
+				vertex.y = (clip[1] / clip[3] * 0.5f + 0.5f) * static_cast<float>(this->height);
+			}
+		}
+
+		for (size_t i = 0; i + 2 < p_mesh.indices.size(); i += 3) {
+			const ScreenVertex& v0 = this->screenVertices[p_mesh.indices[i]];
+			const ScreenVertex& v1 = this->screenVertices[p_mesh.indices[i + 1]];
+			const ScreenVertex& v2 = this->screenVertices[p_mesh.indices[i + 2]];
+			if (v0.w <= MIN_W || v1.w <= MIN_W || v2.w <= MIN_W) {
+				continue;
+			}
+			this->rasterizeTriangle(v0, v1, v2);
+		}
+	}
+
+	/**
+	 * @brief False if every pixel the sphere may cover is nearer than the sphere, p_viewProj being projection * view.
+	*/
+	bool isSphereVisible(const BoundingSphere& p_sphere, const ft::mat4& p_viewProj) const {
+		/* Screen rectangle of the corners of the box around the sphere */
+		float minX = std::numeric_limits<float>::max();
+		float minY = std::numeric_limits<float>::max();
+		float maxX = -std::numeric_limits<float>::max();
+		float maxY = -std::numeric_limits<float>::max();
+		for (uint32_t corner = 0; corner < 8; corner++) {
+			ft::vec3 position(
+				p_sphere.center[0] + (corner & 1 ? p_sphere.radius : -p_sphere.radius),
+				p_sphere.center[1] + (corner & 2 ? p_sphere.radius : -p_sphere.radius),
+				p_sphere.center[2] + (corner & 4 ? p_sphere.radius : -p_sphere.radius)
+			);
+			float clip[4];
+			transform(p_viewProj, position, clip);
+			if (clip[3] <= MIN_W) {
+				return true;
+			}
+
+			float x = (clip[0] / clip[3] * 0.5f + 0.5f) * static_cast<float>(this->width);
+			float y = (clip[1] / clip[3] * 0.5f + 0.5f) * static_cast<float>(this->height);
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+		}
+
+		/* Outside of the buffer, left to the frustum culling */
+		if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(this->width) || minY >= static_cast<float>(this->height)) {
+			return true;
+		}
+
+		/* Nearest clip w of the sphere: w of the center minus the radius scaled like w */
+		float center[4];
+		transform(p_viewProj, p_sphere.center, center);
+		float wScale = std::sqrt(p_viewProj[0][3] * p_viewProj[0][3] + p_viewProj[1][3] * p_viewProj[1][3] + p_viewProj[2][3] * p_viewProj[2][3]);
+		float nearest = center[3] - p_sphere.radius * wScale;
+		if (nearest <= MIN_W) {
+			return true;
+		}
+
+		/* Grown by a pixel, see the coverage rule above */
+		uint32_t x0 = static_cast<uint32_t>(std::max(0.0f, std::floor(minX) - 1.0f));
+		uint32_t y0 = static_cast<uint32_t>(std::max(0.0f, std::floor(minY) - 1.0f));
+		uint32_t x1 = static_cast<uint32_t>(std::min(static_cast<float>(this->width - 1), std::floor(maxX) + 1.0f));
+		uint32_t y1 = static_cast<uint32_t>(std::min(static_cast<float>(this->height - 1), std::floor(maxY) + 1.0f));
+
+		for (uint32_t tileY = y0 / TILE_HEIGHT; tileY <= y1 / TILE_HEIGHT; tileY++) {
+			for (uint32_t tileX = x0 / TILE_WIDTH; tileX <= x1 / TILE_WIDTH; tileX++) {
+				/* Every pixel of the tile is nearer than the sphere */
+				if (this->tileMaxDepth[tileY * this->tilesX + tileX] < nearest) {
+					continue;
+				}
+
+				uint32_t beginX = std::max(x0, tileX * TILE_WIDTH);
+				uint32_t endX = std::min(x1 + 1, (tileX + 1) * TILE_WIDTH);
+				uint32_t beginY = std::max(y0, tileY * TILE_HEIGHT);
+				uint32_t endY = std::min(y1 + 1, (tileY + 1) * TILE_HEIGHT);
+				for (uint32_t y = beginY; y < endY; y++) {
+					for (uint32_t x = beginX; x < endX; x++) {
+						if (this->depthAt(x, y) >= nearest) {
+							return true;
+						}
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	float depthAt(uint32_t p_x, uint32_t p_y) const {
+		return this->depth[this->pixelIndex(p_x, p_y)];
+	}
+
+	const std::vector<float>& getDepth() const {
+		return this->depth;
+	}
+
+	uint32_t getWidth() const {
+		return this->width;
+	}
+
+	uint32_t getHeight() const {
+		return this->height;
+	}
+
+private:
+
+	struct ScreenVertex {
+		float x = 0.0f;
+		float y = 0.0f;
+		float w = 0.0f;
+	};
+
+	/* Edge function a * x + b * y + c, positive inside */
+	struct Edge {
+		float a;
+		float b;
+		float c;
+	};
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tilesX = 0;
+	uint32_t tilesY = 0;
+	/* Tile after tile, each tile row after row */
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+	bool simd = true;
+
+	/* Kept between meshes to avoid allocating for each of them */
+	std::vector<ScreenVertex> screenVertices;
+
+	static void transform(const ft::mat4& p_matrix, const ft::vec3& p_position, float p_clip[4]) {
+		/* p_matrix[column][row] */
+		for (int row = 0; row < 4; row++) {
+			p_clip[row] = p_matrix[0][row] * p_position[0] + p_matrix[1][row] * p_position[1] + p_matrix[2][row] * p_position[2] + p_matrix[3][row];
+		}
+	}
+
+	size_t pixelIndex(uint32_t p_x, uint32_t p_y) const {
+		size_t tile = static_cast<size_t>(p_y / TILE_HEIGHT) * this->tilesX + p_x / TILE_WIDTH;
+		return (tile * TILE_HEIGHT + p_y % TILE_HEIGHT) * TILE_WIDTH + p_x % TILE_WIDTH;
+	}
+
+	static Edge makeEdge(const ScreenVertex& p_from, const ScreenVertex& p_to) {
+		Edge edge;
+		edge.a = p_from.y - p_to.y;
+		edge.b = p_to.x - p_from.x;
+		edge.c = -(edge.a * p_from.x + edge.b * p_from.y);
+		return edge;
+	}
+
+	void rasterizeTriangle(const ScreenVertex& p_v0, const ScreenVertex& p_v1, const ScreenVertex& p_v2) {
+		float area = (p_v1.x - p_v0.x) * (p_v2.y - p_v0.y) - (p_v2.x - p_v0.x) * (p_v1.y - p_v0.y);
+		if (std::fabs(area) < 1e-6f) {
+			return;
+		}
+
+		/* Counter clockwise, so that the inside is on the positive side of every edge */
+		const ScreenVertex& v1 = area > 0.0f ? p_v1 : p_v2;
+		const ScreenVertex& v2 = area > 0.0f ? p_v2 : p_v1;
+		Edge edges[3] = {makeEdge(p_v0, v1), makeEdge(v1, v2), makeEdge(v2, p_v0)};
+
+		/* Farthest depth of the triangle, written in every pixel it covers */
+		float triangleDepth = std::max(p_v0.w, std::max(v1.w, v2.w));
+
+		float minX = std::min(p_v0.x, std::min(v1.x, v2.x));
+		float minY = std::min(p_v0.y, std::min(v1.y, v2.y));
+		float maxX = std::max(p_v0.x, std::max(v1.x, v2.x));
+		float maxY = std::max(p_v0.y, std::max(v1.y, v2.y));
+		if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(this->width) || minY >= static_cast<float>(this->height)) {
+			return;
+		}
+
+		uint32_t tileX0 = static_cast<uint32_t>(std::max(0.0f, minX)) / TILE_WIDTH;
+		uint32_t tileY0 = static_cast<uint32_t>(std::max(0.0f, minY)) / TILE_HEIGHT;
+		uint32_t tileX1 = static_cast<uint32_t>(std::min(static_cast<float>(this->width - 1), maxX)) / TILE_WIDTH;
+		uint32_t tileY1 = static_cast<uint32_t>(std::min(static_cast<float>(this->height - 1), maxY)) / TILE_HEIGHT;
+
+		for (uint32_t tileY = tileY0; tileY <= tileY1; tileY++) {
+			for (uint32_t tileX = tileX0; tileX <= tileX1; tileX++) {
+				float& tileMax = this->tileMaxDepth[tileY * this->tilesX + tileX];
+				/* Every pixel of the tile is already nearer than the triangle */
+				if (triangleDepth >= tileMax) {
+					continue;
+				}
+
+				float* tile = &this->depth[(static_cast<size_t>(tileY) * this->tilesX + tileX) * TILE_WIDTH * TILE_HEIGHT];
+				float x = static_cast<float>(tileX * TILE_WIDTH) + 0.5f;
+				for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+					float y = static_cast<float>(tileY * TILE_HEIGHT + row) + 0.5f;
+					if (this->simd) {
+						fillRow(tile + row * TILE_WIDTH, x, y, edges, triangleDepth);
+					} else {
+						fillRowScalar(tile + row * TILE_WIDTH, x, y, edges, triangleDepth);
+					}
+				}
+
+				float farthest = tile[0];
+				for (uint32_t i = 1; i < TILE_WIDTH * TILE_HEIGHT; i++) {
+					farthest = std::max(farthest, tile[i]);
+				}
+				tileMax = farthest;
+			}
+		}
+	}
+
+	/* Write p_depth in the pixels of the row (starting at the pixel center p_x) whose center is inside the triangle */
+	static void fillRowScalar(float* p_row, float p_x, float p_y, const Edge* p_edges, float p_depth) {
+		for (uint32_t i = 0; i < TILE_WIDTH; i++) {
+			float x = p_x + static_cast<float>(i);
+			bool covered = true;
+			for (int e = 0; e < 3; e++) {
+				float rowBase = p_edges[e].b * p_y + p_edges[e].c;
+				covered = covered && p_edges[e].a * x + rowBase >= 0.0f;
+			}
+			if (covered) {
+				p_row[i] = std::min(p_row[i], p_depth);
+			}
+		}
+	}
+
+	static void fillRow(float* p_row, float p_x, float p_y, const Edge* p_edges, float p_depth) {
+#if defined(__AVX__)
+		__m256 x = _mm256_add_ps(_mm256_set1_ps(p_x), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+		__m256 covered = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int e = 0; e < 3; e++) {
+			float rowBase = p_edges[e].b * p_y + p_edges[e].c;
+			__m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p_edges[e].a), x), _mm256_set1_ps(rowBase));
+			covered = _mm256_and_ps(covered, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		__m256 current = _mm256_loadu_ps(p_row);
+		__m256 written = _mm256_min_ps(current, _mm256_set1_ps(p_depth));
+		_mm256_storeu_ps(p_row, _mm256_blendv_ps(current, written, covered));
+#elif defined(__SSE__)
+		for (uint32_t half = 0; half < TILE_WIDTH; half += 4) {
+			__m128 x = _mm_add_ps(_mm_set1_ps(p_x + static_cast<float>(half)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+			__m128 covered = _mm_cmpeq_ps(x, x);
+			for (int e = 0; e < 3; e++) {
+				float rowBase = p_edges[e].b * p_y + p_edges[e].c;
+				__m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p_edges[e].a), x), _mm_set1_ps(rowBase));
+				covered = _mm_and_ps(covered, _mm_cmpge_ps(value, _mm_setzero_ps()));
+			}
+			__m128 current = _mm_loadu_ps(p_row + half);
+			__m128 written = _mm_min_ps(current, _mm_set1_ps(p_depth));
+			_mm_storeu_ps(p_row + half, _mm_or_ps(_mm_and_ps(covered, written), _mm_andnot_ps(covered, current)));
+		}
+#else
+		fillRowScalar(p_row, p_x, p_y, p_edges, p_depth);
+#endif
+	}
+
+};
+
+#endif // OCCLUSION_RASTERIZER_HPP
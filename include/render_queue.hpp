@@ -0,0 +1,138 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+/* A draw of the frame, index is the position of the drawn object in the scene */
+struct DrawItem {
+	uint64_t key;
+	uint32_t index;
+};
+
+/**
+ * @brief Draws of a frame sorted by a 64 bits key, so that draws sharing a pipeline, then a material, then a mesh follow each other.
+ *
+ * Key layout, from the most significant bits:
+ * 	| pipeline (4) | material (12) | mesh (16) | depth (32) |
+ *
+ * The depth is the bit pattern of a positive float, which sorts like the float itself,
+ * so draws with the same state are sorted front to back.
+ *
+ * The keys are sorted with a LSD radix sort (8 passes of 8 bits), linear in the number of draws.
+ * Passes where every key has the same byte are skipped, which is the case of most high bytes in practice.
+*/
+class RenderQueue {
+
+public:
+
+	static const uint32_t PIPELINE_BITS = 4;
+	static const uint32_t MATERIAL_BITS = 12;
+	static const uint32_t MESH_BITS = 16;
+
+	static uint64_t makeKey(uint32_t p_pipeline, uint32_t p_material, uint32_t p_mesh, float p_depth) {
+		/* Negative depths (behind the camera) all sort first */
+		uint32_t depthBits = 0;
+		if (p_depth > 0.0f) {
+			memcpy(&depthBits, &p_depth, sizeof(depthBits));
+		}
+
+		return (static_cast<uint64_t>(p_pipeline & ((1u << PIPELINE_BITS) - 1)) << 60)
+			| (static_cast<uint64_t>(p_material & ((1u << MATERIAL_BITS) - 1)) << 48)
+			| (static_cast<uint64_t>(p_mesh & ((1u << MESH_BITS) - 1)) << 32)
+			| static_cast<uint64_t>(depthBits);
+	}
+
+	static uint32_t keyPipeline(uint64_t p_key) {
+		return static_cast<uint32_t>(p_key >> 60);
+	}
+
+	static uint32_t keyMaterial(uint64_t p_key) {
+		return static_cast<uint32_t>(p_key >> 48) & ((1u << MATERIAL_BITS) - 1);
+	}
+
+	static uint32_t keyMesh(uint64_t p_key) {
+		return static_cast<uint32_t>(p_key >> 32) & ((1u << MESH_BITS) - 1);
+	}
+
+	/**
+	 * @brief Drop the draws of the previous frame, the memory is kept.
+	*/
+	void clear() {
+		this->items.clear();
+	}
+
+	void push(uint64_t p_key, uint32_t p_index) {
+		this->items.push_back({p_key, p_index});
+	}
+
+	/**
+	 * @brief Sort the draws by key, stable: draws with equal keys keep the order they were pushed in.
+	*/
+	void sort() {
+		size_t count = this->items.size();
+		if (count < 2) {
+			return;
+		}
+
+		/* Histogram of every byte of the keys, built in a single pass */
+		uint32_t histograms[8][256];
+		memset(histograms, 0, sizeof(histograms));
+		for (const DrawItem& item : this->items) {
+			for (uint32_t pass = 0; pass < 8; pass++) {
+				histograms[pass][(item.key >> (pass * 8)) & 0xFF]++;
+			}
+		}
+
+		this->scratch.resize(count);
+		DrawItem* source = this->items.data();
+		DrawItem* destination = this->scratch.data();
+
+		for (uint32_t pass = 0; pass < 8; pass++) {
+			uint32_t* histogram = histograms[pass];
+			uint32_t shift = pass * 8;
+
+			/* Every key has the same byte, the pass would not move anything */
+			if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+				continue;
+			}
+
+			/* Exclusive prefix sum: first position of each bucket */
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < 256; bucket++) {
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+			}
+			std::swap(source, destination);
+		}
+
+		/* An odd number of passes left the result in the scratch buffer */
+		if (source != this->items.data()) {
+			this->items.swap(this->scratch);
+		}
+	}
+
+	const std::vector<DrawItem>& getItems() const {
+		return this->items;
+	}
+
+	size_t size() const {
+		return this->items.size();
+	}
+
+private:
+
+	std::vector<DrawItem> items;
+	/* Destination of the odd passes of the sort, kept between frames */
+	std::vector<DrawItem> scratch;
+
+};
+
+#endif // RENDER_QUEUE_HPP
@@ -0,0 +1,159 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <ft_glm/ft_glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdint>
+
+#include "vertex.hpp"
+#include "geometry_pool.hpp"
+#include "frustum.hpp"
+#include "occlusion_rasterizer.hpp"
+
+/* Object without an occluder, it hides nothing on the CPU */
+const uint32_t NO_OCCLUDER = UINT32_MAX;
+
+/* How the surface of an object is shaded */
+struct Material {
+	/* Texture blended with the vertex colors, NO_TEXTURE for the vertex colors only */
+	uint32_t textureIndex = 0;
+};
+
+/* One drawn object: a mesh of the geometry pool, a material and a transform */
+struct SceneObject {
+	uint32_t mesh = 0;
+	uint32_t material = 0;
+
+	ft::vec3 position = ft::vec3(0.0f, 0.0f, 0.0f);
+	/* Euler angles in radians, applied in the X, Y, Z order */
+	ft::vec3 rotation = ft::vec3(0.0f, 0.0f, 0.0f);
+	ft::vec3 scale = ft::vec3(1.0f, 1.0f, 1.0f);
+	/* Point of the mesh placed at position, the object rotates and scales around it */
+	ft::vec3 pivot = ft::vec3(0.0f, 0.0f, 0.0f);
+	/* Rotation around the Y axis over time, in radians per second */
+	float spinSpeed = 0.0f;
+
+	/* Drawn once per instance of the loaded model (see Object::addInstance) instead of once */
+	bool instanced = false;
+
+	/* Occluder of the scene rasterized with the transform of the object, NO_OCCLUDER if it hides nothing */
+	uint32_t occluder = NO_OCCLUDER;
+
+	/* Sphere bounding the object in world space, p_model being model(time) */
+	BoundingSphere worldBounds(const BoundingSphere& p_meshBounds, const ft::mat4& p_model) const {
+		/* p_model[column][row], the center is transformed as a point */
+		BoundingSphere bounds;
+		for (int row = 0; row < 3; row++) {
+			bounds.center[row] = p_model[0][row] * p_meshBounds.center[0]
+				+ p_model[1][row] * p_meshBounds.center[1]
+				+ p_model[2][row] * p_meshBounds.center[2]
+				+ p_model[3][row];
+		}
+		float maxScale = std::max(std::fabs(this->scale[0]), std::max(std::fabs(this->scale[1]), std::fabs(this->scale[2])));
+		bounds.radius = p_meshBounds.radius * maxScale;
+		return bounds;
+	}
+
+	ft::mat4 model(float p_time) const {
+		ft::mat4 rotate = ft::rotate(p_time * this->spinSpeed, ft::vec3(0.0f, 1.0f, 0.0f))
+			* ft::rotate(this->rotation[2], ft::vec3(0.0f, 0.0f, 1.0f))
+			* ft::rotate(this->rotation[1], ft::vec3(0.0f, 1.0f, 0.0f))
+			* ft::rotate(this->rotation[0], ft::vec3(1.0f, 0.0f, 0.0f));
+
+		ft::vec3 pivot = this->pivot;
+		return ft::translate(this->position) * rotate * ft::scale(this->scale) * ft::translate(-pivot);
+	}
+};
+
+/**
+ * @brief Every object drawn by the renderer, with the meshes and materials they refer to by index.
+ *
+ * Meshes and materials are shared: thousands of objects can use the same mesh of the geometry pool.
+*/
+class Scene {
+
+public:
+
+	uint32_t addMesh(const Mesh& p_mesh, const BoundingSphere& p_bounds = BoundingSphere()) {
+		this->meshes.push_back(p_mesh);
+		this->meshBounds.push_back(p_bounds);
+		return static_cast<uint32_t>(this->meshes.size() - 1);
+	}
+
+	uint32_t addMaterial(const Material& p_material) {
+		this->materials.push_back(p_material);
+		return static_cast<uint32_t>(this->materials.size() - 1);
+	}
+
+	/* Coarse mesh inside the objects using it, in their own space, see OcclusionRasterizer */
+	uint32_t addOccluder(const OccluderMesh& p_occluder) {
+		this->occluders.push_back(p_occluder);
+		return static_cast<uint32_t>(this->occluders.size() - 1);
+	}
+
+	/**
+	 * @throw std::runtime_error if the mesh, the material or the occluder does not exist.
+	*/
+	uint32_t addObject(const SceneObject& p_object) {
+		if (p_object.mesh >= this->meshes.size() || p_object.material >= this->materials.size()) {
+			throw std::runtime_error("scene object refers to an unknown mesh or material!");
+		}
+		if (p_object.occluder != NO_OCCLUDER && p_object.occluder >= this->occluders.size()) {
+			throw std::runtime_error("scene object refers to an unknown occluder!");
+		}
+		this->objects.push_back(p_object);
+		return static_cast<uint32_t>(this->objects.size() - 1);
+	}
+
+	void clearObjects() {
+		this->objects.clear();
+	}
+
+	const Mesh& getMesh(uint32_t p_index) const {
+		return this->meshes[p_index];
+	}
+
+	/* Bounds of the mesh in its own space, used to cull the objects drawing it */
+	const BoundingSphere& getMeshBounds(uint32_t p_index) const {
+		return this->meshBounds[p_index];
+	}
+
+	const Material& getMaterial(uint32_t p_index) const {
+		return this->materials[p_index];
+	}
+
+	const OccluderMesh& getOccluder(uint32_t p_index) const {
+		return this->occluders[p_index];
+	}
+
+	uint32_t occluderCount() const {
+		return static_cast<uint32_t>(this->occluders.size());
+	}
+
+	SceneObject& getObject(uint32_t p_index) {
+		return this->objects[p_index];
+	}
+
+	const std::vector<SceneObject>& getObjects() const {
+		return this->objects;
+	}
+
+	uint32_t objectCount() const {
+		return static_cast<uint32_t>(this->objects.size());
+	}
+
+private:
+
+	std::vector<Mesh> meshes;
+	std::vector<BoundingSphere> meshBounds;
+	std::vector<Material> materials;
+	std::vector<OccluderMesh> occluders;
+	std::vector<SceneObject> objects;
+
+};
+
+#endif // SCENE_HPP
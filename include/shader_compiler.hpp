@@ -0,0 +1,206 @@
+#ifndef SHADER_COMPILER_HPP
+#define SHADER_COMPILER_HPP
+
+#include <shaderc/shaderc.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+
+/**
+ * @brief Compiles the GLSL shaders to SPIR-V at runtime, with an on-disk cache of the results.
+ *
+ * A cached SPIR-V file is named after the FNV-1a hash of everything the compilation depends on:
+ * the stage, the macros and the source. An unchanged shader is read from the cache, while an edited one
+ * gets a new hash and is compiled again, so the cache never has to be cleared by hand.
+ * The shaders do not use #include, so the source holds all of their content.
+ *
+ * Thread safe, pipelines can be created from worker threads.
+*/
+class ShaderCompiler {
+
+public:
+
+	ShaderCompiler(const std::string& p_cacheDirectory): cacheDirectory(p_cacheDirectory) {}
+
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+	/**
+	 * @brief SPIR-V of the shader p_path, whose stage is given by its extension (.vert, .frag or .comp),
+	 * compiled with the macros p_defines ("NAME" or "NAME=VALUE").
+	 *
+	 * @throw std::runtime_error if the source cannot be read or does not compile.
+	*/
+	std::vector<uint32_t> load(const std::string& p_path, const std::vector<std::string>& p_defines = {}) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::string source = readSource(p_path);
+		shaderc_shader_kind kind = shaderKind(p_path);
+		std::filesystem::path cachePath = this->cacheDirectory / (toHex(hash(kind, p_defines, source)) + ".spv");
+
+		std::vector<uint32_t> code = readCache(cachePath);
+		bool cached = !code.empty();
+		if (!cached) {
+			code = this->compile(p_path, kind, p_defines, source);
+			writeCache(cachePath, code);
+		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (cached) {
+			this->cachedCount++;
+			this->cachedMilliseconds += milliseconds;
+		} else {
+			this->compiledCount++;
+			this->compiledMilliseconds += milliseconds;
+		}
+		return code;
+	}
+
+	/* Time spent compiling (cold) and reading from the cache (warm) since the start */
+	void logTimings() {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		std::cout << std::fixed << std::setprecision(3)
+			<< "Shaders: " << this->compiledCount << " compiled in " << this->compiledMilliseconds << " ms, "
+			<< this->cachedCount << " read from " << this->cacheDirectory.string() << " in " << this->cachedMilliseconds << " ms" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	/* 64 bits FNV-1a */
+	static uint64_t hash(const void* p_data, size_t p_size, uint64_t p_hash = 0xcbf29ce484222325ull) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(p_data);
+		for (size_t i = 0; i < p_size; i++) {
+			p_hash ^= bytes[i];
+			p_hash *= 0x100000001b3ull;
+		}
+		return p_hash;
+	}
+
+private:
+
+	/* Changed when the compile options change, so that the SPIR-V compiled with the old ones is not used */
+	static const uint32_t CACHE_VERSION = 1;
+
+	std::filesystem::path cacheDirectory;
+	shaderc::Compiler compiler;
+
+	std::mutex mutex;
+	uint32_t compiledCount = 0;
+	uint32_t cachedCount = 0;
+	double compiledMilliseconds = 0.0;
+	double cachedMilliseconds = 0.0;
+
+	static uint64_t hash(shaderc_shader_kind p_kind, const std::vector<std::string>& p_defines, const std::string& p_source) {
+		uint32_t header[2] = {CACHE_VERSION, static_cast<uint32_t>(p_kind)};
+		uint64_t result = hash(header, sizeof(header));
+		/* The terminating null characters separate the macros, "A" "BC" and "AB" "C" do not hash the same */
+		for (const std::string& define : p_defines) {
+			result = hash(define.c_str(), define.size() + 1, result);
+		}
+		return hash(p_source.data(), p_source.size(), result);
+	}
+
+	static std::string toHex(uint64_t p_value) {
+		std::ostringstream stream;
+		stream << std::hex << std::setw(16) << std::setfill('0') << p_value;
+		return stream.str();
+	}
+
+	static shaderc_shader_kind shaderKind(const std::string& p_path) {
+		std::string extension = std::filesystem::path(p_path).extension().string();
+		if (extension == ".vert") {
+			return shaderc_vertex_shader;
+		} else if (extension == ".frag") {
+			return shaderc_fragment_shader;
+		} else if (extension == ".comp") {
+			return shaderc_compute_shader;
+		}
+		throw std::runtime_error("unknown shader stage: " + p_path + "!");
+	}
+
+	static std::string readSource(const std::string& p_path) {
+		std::ifstream file(p_path, std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open shader source: " + p_path + "!");
+		}
+		std::ostringstream source;
+		source << file.rdbuf();
+		return source.str();
+	}
+
+	/* Empty if the shader is not in the cache */
+	static std::vector<uint32_t> readCache(const std::filesystem::path& p_path) {
+		std::ifstream file(p_path, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			return {};
+		}
+		size_t size = static_cast<size_t>(file.tellg());
+		if (size == 0 || size % sizeof(uint32_t) != 0) {
+			return {};
+		}
+
+		std::vector<uint32_t> code(size / sizeof(uint32_t));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+		if (!file) {
+			return {};
+		}
+		return code;
+	}
+
+	/* Written in a temporary file renamed once complete, so a reader never sees a partial SPIR-V file */
+	static void writeCache(const std::filesystem::path& p_path, const std::vector<uint32_t>& p_code) {
+		std::error_code error;
+		std::filesystem::create_directories(p_path.parent_path(), error);
+
+		std::ostringstream temporaryName;
+		temporaryName << p_path.string() << "." << std::this_thread::get_id() << ".tmp";
+		std::filesystem::path temporaryPath = temporaryName.str();
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(p_code.data()), static_cast<std::streamsize>(p_code.size() * sizeof(uint32_t)));
+			if (!file) {
+				/* Not fatal, the shader is compiled again next time */
+				std::cerr << "Failed to write shader cache " << temporaryPath.string() << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(temporaryPath, p_path, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+		}
+	}
+
+	std::vector<uint32_t> compile(const std::string& p_path, shaderc_shader_kind p_kind, const std::vector<std::string>& p_defines, const std::string& p_source) {
+		shaderc::CompileOptions options;
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+		options.SetOptimizationLevel(shaderc_optimization_level_performance);
+		for (const std::string& define : p_defines) {
+			size_t equal = define.find('=');
+			if (equal == std::string::npos) {
+				options.AddMacroDefinition(define);
+			} else {
+				options.AddMacroDefinition(define.substr(0, equal), define.substr(equal + 1));
+			}
+		}
+
+		shaderc::SpvCompilationResult result = this->compiler.CompileGlslToSpv(p_source, p_kind, p_path.c_str(), options);
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+			throw std::runtime_error("failed to compile shader " + p_path + ": " + result.GetErrorMessage());
+		}
+		return std::vector<uint32_t>(result.cbegin(), result.cend());
+	}
+
+};
+
+#endif // SHADER_COMPILER_HPP
@@ -0,0 +1,194 @@
+#ifndef STAGING_RING_HPP
+#define STAGING_RING_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+
+/*
+ * A range of the staging ring, ready to be written by the CPU and used as the source of a transfer.
+ */
+struct StagingRegion {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	void* mapped = nullptr;
+};
+
+/**
+ * @brief A persistently mapped staging buffer used as a ring: uploads take their source memory from it
+ * instead of creating a temporary buffer each time.
+ *
+ * The allocations made between two calls to closeSpan() form a span, identified by a serial.
+ * The span must be submitted with that serial and given back with retire() once the GPU is done with it.
+ * When the ring is full, the oldest span is waited for with the wait callback (back-pressure).
+ * When it is full of the open span, the caller has to close and submit it first, see tryAllocate().
+ *
+ * Thread safe, uploads can be prepared from worker threads.
+*/
+class StagingRing {
+
+public:
+
+	/* Block until the GPU has consumed the span of the given serial */
+	typedef std::function<void(uint64_t p_serial)> WaitCallback;
+
+	StagingRing() = default;
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	void init(VkBuffer p_buffer, void* p_mapped, VkDeviceSize p_size, WaitCallback p_waitForSpan) {
+		this->buffer = p_buffer;
+		this->mapped = static_cast<char*>(p_mapped);
+		this->size = p_size;
+		this->waitForSpan = std::move(p_waitForSpan);
+
+		this->head = 0;
+		this->tail = 0;
+		this->openSpanUsed = false;
+		this->spans.clear();
+	}
+
+	/**
+	 * @brief Take p_size bytes from the ring, waiting for the GPU to release old spans if needed.
+	 *
+	 * @throw std::runtime_error if p_size does not fit in the ring, even empty, or if the ring is full of unsubmitted allocations.
+	*/
+	StagingRegion allocate(VkDeviceSize p_size, VkDeviceSize p_alignment = 16) {
+		StagingRegion region;
+		if (!this->tryAllocate(p_size, p_alignment, region)) {
+			throw std::runtime_error("staging ring full of unsubmitted uploads!");
+		}
+		return region;
+	}
+
+	/**
+	 * @brief Same as allocate(), but return false when the space is taken by allocations which have not been submitted yet:
+	 * the open span must be closed and submitted before the ring can wait for it.
+	 *
+	 * @throw std::runtime_error if p_size does not fit in the ring, even empty.
+	*/
+	bool tryAllocate(VkDeviceSize p_size, VkDeviceSize p_alignment, StagingRegion& p_region) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (p_size > this->size) {
+			throw std::runtime_error("staging upload larger than the staging ring!");
+		}
+
+		VkDeviceSize offset;
+		while (!this->findRange(p_size, p_alignment, offset)) {
+			if (this->spans.empty()) {
+				return false;
+			}
+			uint64_t oldest = this->spans.front().serial;
+			this->waitForSpan(oldest);
+			this->retireLocked(oldest);
+		}
+
+		this->head = offset + p_size;
+		this->openSpanUsed = true;
+
+		p_region.buffer = this->buffer;
+		p_region.offset = offset;
+		p_region.mapped = this->mapped + offset;
+		return true;
+	}
+
+	/**
+	 * @brief Close the span of the allocations made since the last call and return its serial.
+	*/
+	uint64_t closeSpan() {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		uint64_t serial = ++this->lastSerial;
+		this->spans.push_back({serial, this->head});
+		this->openSpanUsed = false;
+		return serial;
+	}
+
+	/**
+	 * @brief Give back the memory of every span up to p_serial (included).
+	*/
+	void retire(uint64_t p_serial) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->retireLocked(p_serial);
+	}
+
+	VkBuffer getBuffer() const {
+		return this->buffer;
+	}
+
+private:
+
+	struct Span {
+		uint64_t serial;
+		/* Offset right after the last byte of the span, the tail moves there once it is retired */
+		VkDeviceSize end;
+	};
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	char* mapped = nullptr;
+	VkDeviceSize size = 0;
+	WaitCallback waitForSpan;
+
+	/* Live data goes from tail to head, possibly wrapping around the end of the buffer */
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+	bool openSpanUsed = false;
+	std::deque<Span> spans;
+	uint64_t lastSerial = 0;
+
+	std::mutex mutex;
+
+	static VkDeviceSize alignUp(VkDeviceSize p_value, VkDeviceSize p_alignment) {
+		return (p_value + p_alignment - 1) / p_alignment * p_alignment;
+	}
+
+	bool isEmpty() const {
+		return this->spans.empty() && !this->openSpanUsed;
+	}
+
+	bool findRange(VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize& p_offset) {
+		if (this->isEmpty()) {
+			this->head = 0;
+			this->tail = 0;
+			p_offset = 0;
+			return true;
+		}
+
+		VkDeviceSize aligned = alignUp(this->head, p_alignment);
+
+		if (this->head > this->tail) {
+			/* Free space is at the end of the buffer, then at the beginning until the tail */
+			if (aligned + p_size <= this->size) {
+				p_offset = aligned;
+				return true;
+			}
+			if (p_size <= this->tail) {
+				/* Wrap around, the end of the buffer is wasted until the current span is retired */
+				p_offset = 0;
+				return true;
+			}
+		} else if (this->head < this->tail) {
+			if (aligned + p_size <= this->tail) {
+				p_offset = aligned;
+				return true;
+			}
+		}
+		/* head == tail on a non empty ring: the ring is full */
+		return false;
+	}
+
+	void retireLocked(uint64_t p_serial) {
+		while (!this->spans.empty() && this->spans.front().serial <= p_serial) {
+			this->tail = this->spans.front().end;
+			this->spans.pop_front();
+		}
+	}
+
+};
+
+#endif // STAGING_RING_HPP
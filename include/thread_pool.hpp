@@ -0,0 +1,113 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+
+/**
+ * @brief A fixed size pool of worker threads consuming a FIFO queue of tasks.
+*/
+class ThreadPool {
+
+public:
+
+	/**
+	 * @brief Construct a new ThreadPool object and start its workers.
+	 *
+	 * @param p_threadCount The number of workers, 0 means one per hardware thread.
+	*/
+	ThreadPool(size_t p_threadCount = 0) {
+		if (p_threadCount == 0) {
+			p_threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (size_t i = 0; i < p_threadCount; i++) {
+			this->workers.emplace_back([this] { this->workerLoop(); });
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Finish the queued tasks and join the workers.
+	*/
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->condition.notify_all();
+
+		for (std::thread& worker : this->workers) {
+			worker.join();
+		}
+	}
+
+	/**
+	 * @brief Queue a task and return a future holding its result (or the exception it threw).
+	*/
+	template<typename F>
+	auto submit(F&& p_task) -> std::future<std::invoke_result_t<F>> {
+		typedef std::invoke_result_t<F> Result;
+
+		/* std::function needs a copyable callable, so the packaged_task is shared */
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(p_task));
+		std::future<Result> future = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->tasks.emplace([task] { (*task)(); });
+		}
+		this->condition.notify_one();
+
+		return future;
+	}
+
+	/**
+	 * @brief Return the number of workers.
+	*/
+	size_t size() const {
+		return this->workers.size();
+	}
+
+private:
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	void workerLoop() {
+		while (true) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->condition.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+
+				if (this->stopping && this->tasks.empty()) {
+					return;
+				}
+
+				task = std::move(this->tasks.front());
+				this->tasks.pop();
+			}
+
+			task();
+		}
+	}
+
+};
+
+#endif // THREAD_POOL_HPP
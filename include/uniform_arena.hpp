@@ -0,0 +1,87 @@
+#ifndef UNIFORM_ARENA_HPP
+#define UNIFORM_ARENA_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+/**
+ * @brief One persistently mapped uniform buffer holding the uniform data of every frame in flight.
+ *
+ * The buffer is split in one region per frame in flight. Each frame bump-allocates its per-frame and per-draw data
+ * in its region and binds it with dynamic offsets (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC), so the descriptor sets
+ * point to the whole buffer once and for all and are never rewritten.
+ *
+ * A region is reused by beginFrame() only once the GPU is done with the frame which last used it,
+ * i.e. after waiting for the in flight fence of that frame.
+*/
+class UniformArena {
+
+public:
+
+	void init(VkBuffer p_buffer, void* p_mapped, VkDeviceSize p_frameSize, uint32_t p_frameCount, VkDeviceSize p_minOffsetAlignment) {
+		this->buffer = p_buffer;
+		this->mapped = static_cast<char*>(p_mapped);
+		this->frameSize = p_frameSize;
+		this->frameCount = p_frameCount;
+		this->alignment = p_minOffsetAlignment > 0 ? p_minOffsetAlignment : 1;
+
+		this->frameBegin = 0;
+		this->head = 0;
+	}
+
+	/**
+	 * @brief Start bump-allocating in the region of the frame, dropping what it held.
+	*/
+	void beginFrame(uint32_t p_frameIndex) {
+		this->frameBegin = static_cast<VkDeviceSize>(p_frameIndex % this->frameCount) * this->frameSize;
+		this->head = this->frameBegin;
+	}
+
+	/**
+	 * @brief Copy p_data in the region of the current frame and return its dynamic offset.
+	 *
+	 * @throw std::runtime_error if the region of the frame is full.
+	*/
+	uint32_t push(const void* p_data, VkDeviceSize p_size) {
+		/* Dynamic offsets must be multiples of minUniformBufferOffsetAlignment */
+		VkDeviceSize offset = (this->head + this->alignment - 1) / this->alignment * this->alignment;
+		if (offset + p_size > this->frameBegin + this->frameSize) {
+			throw std::runtime_error("uniform arena full for this frame!");
+		}
+
+		memcpy(this->mapped + offset, p_data, static_cast<size_t>(p_size));
+		this->head = offset + p_size;
+		return static_cast<uint32_t>(offset);
+	}
+
+	template<typename T>
+	uint32_t push(const T& p_data) {
+		return this->push(&p_data, sizeof(T));
+	}
+
+	VkBuffer getBuffer() const {
+		return this->buffer;
+	}
+
+	/* Bytes used in the region of the current frame */
+	VkDeviceSize getFrameUsage() const {
+		return this->head - this->frameBegin;
+	}
+
+private:
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	char* mapped = nullptr;
+	VkDeviceSize frameSize = 0;
+	uint32_t frameCount = 1;
+	VkDeviceSize alignment = 1;
+
+	VkDeviceSize frameBegin = 0;
+	VkDeviceSize head = 0;
+
+};
+
+#endif // UNIFORM_ARENA_HPP
@@ -0,0 +1,486 @@
+#ifndef UPLOAD_CONTEXT_HPP
+#define UPLOAD_CONTEXT_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+#include "staging_ring.hpp"
+
+/* Handle of a submitted batch of uploads, it is the serial of the staging span read by the batch */
+typedef uint64_t UploadTicket;
+
+/**
+ * @brief Record many transfers and barriers into one command buffer and submit them at once.
+ *
+ * Instead of submitting and waiting for the queue to be idle after every copy, the upload functions record into
+ * commandBuffer() and a single flush() submits the whole batch with a fence. The returned ticket can be polled
+ * with isComplete() or waited for with wait(), and the staging ring is given back as batches complete.
+ *
+ * When the device has a transfer only queue family, the copies run on it so that they overlap rendering.
+ * The images are then owned by the transfer family: releaseImage() records the release barrier in the transfer
+ * command buffer and the matching acquire barrier in a command buffer submitted to the graphics queue, which waits
+ * for the transfer with a semaphore. The buffers are written again after being used for rendering (e.g. the ranges
+ * of the geometry pool), so they are shared by both families instead (see getSharingFamilies()) and releaseBuffer()
+ * only makes the writes visible to the graphics queue. Without such a family, everything is recorded in a single
+ * command buffer submitted to the graphics queue.
+ *
+ * Any thread can queue uploads with enqueue(), the requests are recorded by the next flush().
+*/
+class UploadContext {
+
+public:
+
+	/* Record the transfers of a request, its data being already in the staging region */
+	typedef std::function<void(const StagingRegion& p_region)> Recorder;
+
+	UploadContext() = default;
+	UploadContext(const UploadContext&) = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+
+	/**
+	 * @brief p_transferQueue can be VK_NULL_HANDLE, or the same family as the graphics queue, to upload on the graphics queue.
+	*/
+	void init(VkDevice p_device, VkQueue p_graphicsQueue, uint32_t p_graphicsFamily, VkQueue p_transferQueue, uint32_t p_transferFamily, StagingRing* p_stagingRing) {
+		this->device = p_device;
+		this->graphicsQueue = p_graphicsQueue;
+		this->graphicsFamily = p_graphicsFamily;
+		this->stagingRing = p_stagingRing;
+		/* The thread creating the context records and submits the batches */
+		this->recordingThread = std::this_thread::get_id();
+
+		this->dedicatedTransfer = p_transferQueue != VK_NULL_HANDLE && p_transferFamily != p_graphicsFamily;
+		this->transferQueue = this->dedicatedTransfer ? p_transferQueue : p_graphicsQueue;
+		this->transferFamily = this->dedicatedTransfer ? p_transferFamily : p_graphicsFamily;
+
+		this->transferPool = this->createCommandPool(this->transferFamily);
+		if (this->dedicatedTransfer) {
+			this->acquirePool = this->createCommandPool(this->graphicsFamily);
+		}
+	}
+
+	void destroy() {
+		this->waitIdle();
+
+		for (auto& batch : this->batches) {
+			vkDestroyFence(this->device, batch->fence, nullptr);
+			if (batch->transferDone != VK_NULL_HANDLE) {
+				vkDestroySemaphore(this->device, batch->transferDone, nullptr);
+			}
+		}
+		this->batches.clear();
+		this->inFlight.clear();
+		this->recording = nullptr;
+
+		/* Destroying the pools frees their command buffers */
+		vkDestroyCommandPool(this->device, this->transferPool, nullptr);
+		if (this->acquirePool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(this->device, this->acquirePool, nullptr);
+		}
+	}
+
+	bool hasDedicatedTransferQueue() const {
+		return this->dedicatedTransfer;
+	}
+
+	/**
+	 * @brief Return the transfer command buffer of the batch being recorded, starting a new batch if needed.
+	 *
+	 * It runs on the transfer queue, only transfer commands and barriers on transfer stages can be recorded.
+	*/
+	VkCommandBuffer commandBuffer() {
+		if (this->recording == nullptr) {
+			this->recording = this->acquireBatch();
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			if (vkBeginCommandBuffer(this->recording->transferCommandBuffer, &beginInfo) != VK_SUCCESS
+				|| (this->dedicatedTransfer && vkBeginCommandBuffer(this->recording->acquireCommandBuffer, &beginInfo) != VK_SUCCESS)) {
+				throw std::runtime_error("failed to begin recording upload command buffer!");
+			}
+		}
+		return this->recording->transferCommandBuffer;
+	}
+
+	/**
+	 * @brief Queue families the buffers written by the batches must be shared with (VK_SHARING_MODE_CONCURRENT),
+	 * empty when everything runs on the graphics queue. Such buffers have no owner to transfer between the families.
+	*/
+	std::vector<uint32_t> getSharingFamilies() const {
+		if (!this->dedicatedTransfer) {
+			return {};
+		}
+		return {this->transferFamily, this->graphicsFamily};
+	}
+
+	/**
+	 * @brief Make a range of a buffer written by the batch visible to the graphics queue, for vertex, index, uniform or shader reads.
+	 * With a dedicated transfer queue, the buffer must be shared with getSharingFamilies().
+	*/
+	void releaseBuffer(VkBuffer p_buffer, VkDeviceSize p_offset, VkDeviceSize p_size) {
+		if (!this->dedicatedTransfer) {
+			/* Same queue: the memory barrier recorded by flush() is enough */
+			return;
+		}
+
+		/* The semaphore makes the transfers available, the barrier after its wait on the graphics queue makes them visible
+			to the commands submitted after it. No ownership transfer: the buffer is concurrent, the families are ignored */
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = p_buffer;
+		barrier.offset = p_offset;
+		barrier.size = p_size;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = READ_ACCESS;
+
+		/* Records the transfer command buffer too, so that commandBuffer() has begun the acquire command buffer */
+		this->commandBuffer();
+		vkCmdPipelineBarrier(this->recording->acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, READ_STAGES, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	/**
+	 * @brief Record the last barrier of an image written by the batch (typically TRANSFER_DST to SHADER_READ_ONLY),
+	 * handing the image over to the graphics queue if needed. The queue family indices of p_barrier are filled here.
+	*/
+	void releaseImage(VkImageMemoryBarrier p_barrier, VkPipelineStageFlags p_srcStage, VkPipelineStageFlags p_dstStage) {
+		if (!this->dedicatedTransfer) {
+			p_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			p_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			vkCmdPipelineBarrier(this->commandBuffer(), p_srcStage, p_dstStage, 0, 0, nullptr, 0, nullptr, 1, &p_barrier);
+			return;
+		}
+
+		/* Both halves of an ownership transfer must describe the same layout transition */
+		p_barrier.srcQueueFamilyIndex = this->transferFamily;
+		p_barrier.dstQueueFamilyIndex = this->graphicsFamily;
+
+		VkAccessFlags dstAccessMask = p_barrier.dstAccessMask;
+		p_barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(this->commandBuffer(), p_srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &p_barrier);
+
+		p_barrier.srcAccessMask = 0;
+		p_barrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(this->recording->acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, p_dstStage, 0, 0, nullptr, 0, nullptr, 1, &p_barrier);
+	}
+
+	/**
+	 * @brief Copy p_size bytes of p_data into the staging ring and queue p_record to be recorded by the next flush().
+	 *
+	 * Can be called from any thread, e.g. right after decoding an asset on a worker.
+	 * When the staging ring is full of requests which were not submitted yet, the recording thread submits them with flush()
+	 * and the ring then waits for the GPU to consume them. Other threads block until the recording thread flushes or collects,
+	 * so it must not wait for them while they enqueue.
+	*/
+	void enqueue(const void* p_data, VkDeviceSize p_size, VkDeviceSize p_alignment, Recorder p_record) {
+		/* The staging span closed by flush() must only hold regions of requests it records, so allocating and queueing are done under the same lock */
+		std::unique_lock<std::mutex> lock(this->requestMutex);
+
+		StagingRegion region;
+		while (!this->stagingRing->tryAllocate(p_size, p_alignment, region)) {
+			if (std::this_thread::get_id() != this->recordingThread) {
+				/* Only the recording thread can submit, the worker waits for its next flush() (once per frame) */
+				this->requestsSubmitted.wait(lock);
+				continue;
+			}
+			lock.unlock();
+			this->flush();
+			lock.lock();
+		}
+		memcpy(region.mapped, p_data, static_cast<size_t>(p_size));
+
+		this->requests.push_back({region, std::move(p_record)});
+	}
+
+	/**
+	 * @brief Record the queued requests and submit the batch. Nothing waits for it, use the returned ticket for that.
+	 *
+	 * Must be called from the thread recording the batch (the main thread).
+	 *
+	 * @return The ticket of the batch, or of the last submitted batch if nothing was recorded.
+	*/
+	UploadTicket flush() {
+		this->collect();
+
+		Batch* batch;
+		{
+			std::lock_guard<std::mutex> lock(this->requestMutex);
+
+			for (Request& request : this->requests) {
+				request.record(request.region);
+			}
+			this->requests.clear();
+
+			if (this->recording == nullptr) {
+				return this->lastTicket;
+			}
+
+			batch = this->recording;
+			this->recording = nullptr;
+
+			if (!this->dedicatedTransfer) {
+				/* Make the transfers visible to every later use of the resources, in this or later submissions */
+				VkMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = READ_ACCESS;
+				vkCmdPipelineBarrier(batch->transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READ_STAGES, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			if (vkEndCommandBuffer(batch->transferCommandBuffer) != VK_SUCCESS
+				|| (this->dedicatedTransfer && vkEndCommandBuffer(batch->acquireCommandBuffer) != VK_SUCCESS)) {
+				throw std::runtime_error("failed to record upload command buffer!");
+			}
+
+			/* Everything taken from the staging ring until now is read by this batch */
+			batch->ticket = this->stagingRing->closeSpan();
+			/* The ring can wait for the GPU to consume the span now, instead of being full of unsubmitted requests */
+			this->requestsSubmitted.notify_all();
+		}
+
+		vkResetFences(this->device, 1, &batch->fence);
+
+		if (this->dedicatedTransfer) {
+			VkSubmitInfo transferSubmit{};
+			transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transferSubmit.commandBufferCount = 1;
+			transferSubmit.pCommandBuffers = &batch->transferCommandBuffer;
+			transferSubmit.signalSemaphoreCount = 1;
+			transferSubmit.pSignalSemaphores = &batch->transferDone;
+
+			if (vkQueueSubmit(this->transferQueue, 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload command buffer!");
+			}
+
+			/* The acquire barriers run on the graphics queue once the transfers are done, the frames submitted after it see the data */
+			VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkSubmitInfo acquireSubmit{};
+			acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireSubmit.waitSemaphoreCount = 1;
+			acquireSubmit.pWaitSemaphores = &batch->transferDone;
+			acquireSubmit.pWaitDstStageMask = &waitStage;
+			acquireSubmit.commandBufferCount = 1;
+			acquireSubmit.pCommandBuffers = &batch->acquireCommandBuffer;
+
+			if (vkQueueSubmit(this->graphicsQueue, 1, &acquireSubmit, batch->fence) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload acquire command buffer!");
+			}
+		} else {
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch->transferCommandBuffer;
+
+			if (vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, batch->fence) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload command buffer!");
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(this->batchMutex);
+		this->inFlight.push_back(batch);
+		this->lastTicket = batch->ticket;
+		this->batchSubmitted.notify_all();
+		return batch->ticket;
+	}
+
+	/**
+	 * @brief Return true if there are queued requests or recorded commands waiting for flush().
+	*/
+	bool hasPendingUploads() {
+		std::lock_guard<std::mutex> lock(this->requestMutex);
+		return !this->requests.empty() || this->recording != nullptr;
+	}
+
+	/**
+	 * @brief Return true if the GPU is done with the batch of the ticket.
+	*/
+	bool isComplete(UploadTicket p_ticket) {
+		this->collect();
+
+		std::lock_guard<std::mutex> lock(this->batchMutex);
+		return p_ticket <= this->completedTicket;
+	}
+
+	/**
+	 * @brief Block until the GPU is done with the batch of the ticket.
+	 *
+	 * Does not touch the staging ring, so it can be used as the staging ring wait callback, from any thread.
+	 * The ticket of a span closed by flush() may not be submitted yet, it is waited for until it is.
+	*/
+	void wait(UploadTicket p_ticket) {
+		/* Batches are not recycled while we hold the lock, so the fences cannot be reset under our feet */
+		std::unique_lock<std::mutex> lock(this->batchMutex);
+		/* Not in inFlight yet, its staging data is still to be read by the GPU */
+		this->batchSubmitted.wait(lock, [this, p_ticket] { return p_ticket <= this->lastTicket; });
+
+		for (Batch* batch : this->inFlight) {
+			if (batch->ticket > p_ticket) {
+				break;
+			}
+			vkWaitForFences(this->device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+		}
+		this->completedTicket = std::max(this->completedTicket, p_ticket);
+	}
+
+	void waitIdle() {
+		UploadTicket last;
+		{
+			std::lock_guard<std::mutex> lock(this->batchMutex);
+			last = this->lastTicket;
+		}
+		this->wait(last);
+		this->collect();
+	}
+
+	/**
+	 * @brief Recycle the completed batches and give their staging memory back. Called by flush(), or once per frame.
+	*/
+	void collect() {
+		UploadTicket completed;
+		{
+			std::lock_guard<std::mutex> lock(this->batchMutex);
+			while (!this->inFlight.empty() && vkGetFenceStatus(this->device, this->inFlight.front()->fence) == VK_SUCCESS) {
+				this->completedTicket = std::max(this->completedTicket, this->inFlight.front()->ticket);
+				this->inFlight.pop_front();
+			}
+			completed = this->completedTicket;
+		}
+		/* Outside of the batch lock: the staging ring calls wait() with its own lock held */
+		this->stagingRing->retire(completed);
+		this->requestsSubmitted.notify_all();
+	}
+
+private:
+
+	/* Every way the graphics queue reads uploaded data */
+	static constexpr VkAccessFlags READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	static constexpr VkPipelineStageFlags READ_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	struct Batch {
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		/* Only with a dedicated transfer queue */
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore transferDone = VK_NULL_HANDLE;
+
+		VkFence fence = VK_NULL_HANDLE;
+		UploadTicket ticket = 0;
+	};
+
+	struct Request {
+		StagingRegion region;
+		Recorder record;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	StagingRing* stagingRing = nullptr;
+	std::thread::id recordingThread;
+
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	uint32_t graphicsFamily = 0;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	bool dedicatedTransfer = false;
+
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool acquirePool = VK_NULL_HANDLE;
+
+	std::vector<std::unique_ptr<Batch>> batches;
+	/* Submitted batches, oldest first */
+	std::deque<Batch*> inFlight;
+	Batch* recording = nullptr;
+
+	UploadTicket lastTicket = 0;
+	UploadTicket completedTicket = 0;
+
+	std::vector<Request> requests;
+
+	/* Lock order: requestMutex, then the staging ring, then batchMutex */
+	std::mutex requestMutex;
+	/* Signalled by flush() and collect(), for the enqueue() of other threads waiting for room in the staging ring */
+	std::condition_variable requestsSubmitted;
+	std::mutex batchMutex;
+	/* Signalled by flush() once a batch is in inFlight, for wait() on a ticket closed but not submitted yet */
+	std::condition_variable batchSubmitted;
+
+	VkCommandPool createCommandPool(uint32_t p_queueFamilyIndex) {
+		/* Upload command buffers are short lived and reset individually when their batch is reused */
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex = p_queueFamilyIndex;
+
+		VkCommandPool pool;
+		if (vkCreateCommandPool(this->device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+		return pool;
+	}
+
+	VkCommandBuffer allocateCommandBuffer(VkCommandPool p_pool) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = p_pool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(this->device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+		return commandBuffer;
+	}
+
+	Batch* acquireBatch() {
+		std::lock_guard<std::mutex> lock(this->batchMutex);
+
+		/* Reuse a batch which is neither recording nor in flight */
+		for (auto& batch : this->batches) {
+			bool busy = batch.get() == this->recording || std::find(this->inFlight.begin(), this->inFlight.end(), batch.get()) != this->inFlight.end();
+			if (!busy) {
+				vkResetCommandBuffer(batch->transferCommandBuffer, 0);
+				if (this->dedicatedTransfer) {
+					vkResetCommandBuffer(batch->acquireCommandBuffer, 0);
+				}
+				return batch.get();
+			}
+		}
+
+		auto batch = std::make_unique<Batch>();
+		batch->transferCommandBuffer = this->allocateCommandBuffer(this->transferPool);
+
+		if (this->dedicatedTransfer) {
+			batch->acquireCommandBuffer = this->allocateCommandBuffer(this->acquirePool);
+
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &batch->transferDone) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create upload semaphore!");
+			}
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(this->device, &fenceInfo, nullptr, &batch->fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		this->batches.push_back(std::move(batch));
+		return this->batches.back().get();
+	}
+
+};
+
+#endif // UPLOAD_CONTEXT_HPP
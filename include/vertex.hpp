@@ -11,6 +11,7 @@
 
 #include <array>
 #include <vector>
+#include <cstdint>
 
 struct Vertex {
 	ft::vec3 pos;
@@ -99,11 +100,98 @@ namespace std {
 	};
 }
 
+/* Texture index of an instance or a material drawn with its vertex colors only */
+const uint32_t NO_TEXTURE = UINT32_MAX;
+
+/* Per-instance attributes, read from a second vertex buffer advanced once per instance */
+struct InstanceData {
+	/* Placement of the instance relative to the object */
+	ft::mat4 model;
+	/* Multiplied with the vertex color */
+	ft::vec4 color;
+	/* Texture sampled by the instance, NO_TEXTURE for none */
+	uint32_t textureIndex;
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	/* Locations follow the ones of Vertex, a mat4 takes 4 locations (one vec4 per column) */
+	static std::array<VkVertexInputAttributeDescription, 6> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 6> attributeDescriptions{};
+
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions[column].binding = 1;
+			attributeDescriptions[column].location = 4 + column;
+			attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(ft::vec4);
+		}
+
+		attributeDescriptions[4].binding = 1;
+		attributeDescriptions[4].location = 8;
+		attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[4].offset = offsetof(InstanceData, color);
+
+		attributeDescriptions[5].binding = 1;
+		attributeDescriptions[5].location = 9;
+		attributeDescriptions[5].format = VK_FORMAT_R32_UINT;
+		attributeDescriptions[5].offset = offsetof(InstanceData, textureIndex);
+
+		return attributeDescriptions;
+	}
+};
+
 /* Always align uniform buffer objects to avoid issues with padding */
-struct ModelViewPerspective {
-	alignas(16) ft::mat4 model;
+/* Per-frame data shared by every draw */
+struct FrameUniforms {
 	alignas(16) ft::mat4 view;
 	alignas(16) ft::mat4 proj;
+	alignas(16) ft::mat4 viewProj;
+	/* Planes of the view frustum (see Frustum), read by the culling compute shader */
+	alignas(16) float frustumPlanes[6][4];
+};
+
+/* Per-draw data pushed in the command buffer, only 128 bytes of push constants are guaranteed */
+struct DrawPushConstants {
+	/* proj * view * model, combined on the CPU once per draw instead of per vertex */
+	ft::mat4 mvp;
+	float colorTextureBlending;
+};
+
+/* Per-draw data of the indirect draws, read from a storage buffer at gl_InstanceIndex, padded like a std430 array element */
+struct alignas(16) DrawData {
+	ft::mat4 mvp;
+	float colorTextureBlending;
+};
+
+/* Push constants of the culling compute shader (shaders/cull.comp) */
+struct CullPushConstants {
+	uint32_t drawCount;
+	/* Offsets of the frame region in the command buffers, in 32 bits words */
+	uint32_t commandWord;
+	uint32_t countWord;
+	/* Index of the first bounding sphere of the frame */
+	uint32_t firstBounds;
+	/* Append the visible draws and count them, instead of zeroing the instanceCount of the culled ones */
+	uint32_t compact;
+	/* Occlusion culling only: CULL_PHASE_EARLY or CULL_PHASE_LATE */
+	uint32_t phase;
+	/* Added to the offsets of the outputs, selects the region of the phase in the culled command buffer */
+	uint32_t outputWord;
+};
+
+/* Bounds of one indirect draw read by the culling compute shader, std430 layout */
+struct CullBounds {
+	/* xyz: world center, w: radius */
+	float sphere[4];
+	/* Index of the scene object, keeps its visibility from one frame to the next */
+	uint32_t object;
+	uint32_t padding[3];
 };
 
 /* TODO: remove this */
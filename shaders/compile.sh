@@ -1,4 +1,5 @@
-# TODO: See libshaderc for runtime compilation
+# The application compiles the shaders at runtime with libshaderc (see include/shader_compiler.hpp),
+# this script is only useful to check them or inspect their SPIR-V offline.
 
 # https://github.com/google/shaderc/blob/main/downloads.md to download glslc
 
@@ -6,4 +7,11 @@
 # /usr/local/bin/glslc shader.frag -o frag.spv
 
 glslang -V shader.vert -o vert.spv
-glslang -V shader.frag -o frag.spv
\ No newline at end of file
+glslang -V shader.frag -o frag.spv
+glslang -V instanced.vert -o instanced_vert.spv
+glslang -V instanced.frag -o instanced_frag.spv
+glslang -V indirect.vert -o indirect_vert.spv
+glslang -V indirect.frag -o indirect_frag.spv
+glslang -V cull.comp -o cull_comp.spv
+glslang -V -DOCCLUSION cull.comp -o cull_occlusion_comp.spv
+glslang -V depth_reduce.comp -o depth_reduce_comp.spv
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 450
+
+/* Pipeline variant, see SHADING_* in application.hpp: the branches of the other modes are removed when the pipeline is created */
+layout(constant_id = 0) const uint SHADING_MODE = 0;
+const uint SHADING_BLENDED = 0;
+const uint SHADING_COLOR = 1;
+const uint SHADING_TEXTURE = 2;
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in float fragColorTextureBlending;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	if (SHADING_MODE == SHADING_COLOR) {
+		outColor = vec4(fragColor, 1.0);
+	} else if (SHADING_MODE == SHADING_TEXTURE) {
+		/* Flat per draw, the texture has a single mip level so the fetch does not need derivatives across draws */
+		outColor = fragColorTextureBlending > 0.0 ? texture(texSampler, fragTexCoord) : vec4(fragColor, 1.0);
+	} else {
+		outColor = ((1 - fragColorTextureBlending) * vec4(fragColor, 1.0)) + (fragColorTextureBlending * texture(texSampler, fragTexCoord));
+	}
+}
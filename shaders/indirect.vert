@@ -0,0 +1,33 @@
+#version 450
+
+/*
+ * Same as shader.vert for the draws submitted with vkCmdDrawIndexedIndirect:
+ * push constants cannot change between the draws of a single call, so the per-draw data is read from a storage buffer.
+ * The firstInstance of each indirect command is the index of its data, which makes gl_InstanceIndex the draw index.
+ */
+
+struct DrawData {
+    mat4 mvp;
+    float colorTextureBlending;
+};
+
+layout(std430, binding = 2) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inNormal;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out float fragColorTextureBlending;
+
+void main() {
+    DrawData draw = draws[gl_InstanceIndex];
+    gl_Position = draw.mvp * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+    fragColorTextureBlending = draw.colorTextureBlending;
+}
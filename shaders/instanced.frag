@@ -0,0 +1,34 @@
+#version 450
+
+/* Only one texture is bound, any index other than NO_TEXTURE samples it */
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+/* Pipeline variant, see SHADING_* in application.hpp: the branches of the other modes are removed when the pipeline is created */
+layout(constant_id = 0) const uint SHADING_MODE = 0;
+const uint SHADING_BLENDED = 0;
+const uint SHADING_COLOR = 1;
+const uint SHADING_TEXTURE = 2;
+
+layout(binding = 1) uniform sampler2D texSampler;
+layout(push_constant) uniform DrawPushConstants {
+	mat4 mvp;
+	float colorTextureBlending;
+} draw;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	if (SHADING_MODE == SHADING_COLOR) {
+		outColor = vec4(fragColor, 1.0);
+	} else if (SHADING_MODE == SHADING_TEXTURE) {
+		/* Flat per instance, the texture has a single mip level so the fetch does not need derivatives across instances */
+		outColor = fragTextureIndex != NO_TEXTURE ? texture(texSampler, fragTexCoord) : vec4(fragColor, 1.0);
+	} else {
+		float blending = fragTextureIndex == NO_TEXTURE ? 0.0 : draw.colorTextureBlending;
+		outColor = ((1 - blending) * vec4(fragColor, 1.0)) + (blending * texture(texSampler, fragTexCoord));
+	}
+}
@@ -0,0 +1,32 @@
+#version 450
+
+/*
+ * Same as shader.vert for a mesh drawn once per instance:
+ * each instance is placed by its own model matrix, applied before the MVP of the object.
+ */
+
+layout(push_constant) uniform DrawPushConstants {
+    mat4 mvp;
+    float colorTextureBlending;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inNormal;
+
+/* Per-instance attributes (VK_VERTEX_INPUT_RATE_INSTANCE), a mat4 takes locations 4 to 7 */
+layout(location = 4) in mat4 inInstanceModel;
+layout(location = 8) in vec4 inInstanceColor;
+layout(location = 9) in uint inInstanceTextureIndex;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
+
+void main() {
+    gl_Position = draw.mvp * inInstanceModel * vec4(inPosition, 1.0);
+    fragColor = inColor * inInstanceColor.rgb;
+    fragTexCoord = inTexCoord;
+    fragTextureIndex = inInstanceTextureIndex;
+}
@@ -1,9 +1,16 @@
 #version 450
 
+/* Pipeline variant, see SHADING_* in application.hpp: the branches of the other modes are removed when the pipeline is created */
+layout(constant_id = 0) const uint SHADING_MODE = 0;
+const uint SHADING_BLENDED = 0;
+const uint SHADING_COLOR = 1;
+const uint SHADING_TEXTURE = 2;
+
 layout(binding = 1) uniform sampler2D texSampler;
-layout(binding = 2) uniform ColorTextureBlending{
+layout(push_constant) uniform DrawPushConstants {
+	mat4 mvp;
 	float colorTextureBlending;
-};
+} draw;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -11,6 +18,12 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    // outColor = texture(texSampler, fragTexCoord);
-	outColor = ((1 - colorTextureBlending) * vec4(fragColor, 1.0)) + (colorTextureBlending * texture(texSampler, fragTexCoord));
+	if (SHADING_MODE == SHADING_COLOR) {
+		outColor = vec4(fragColor, 1.0);
+	} else if (SHADING_MODE == SHADING_TEXTURE) {
+		/* The ratio is settled at 1, it is only 0 for the materials without a texture */
+		outColor = draw.colorTextureBlending > 0.0 ? texture(texSampler, fragTexCoord) : vec4(fragColor, 1.0);
+	} else {
+		outColor = ((1 - draw.colorTextureBlending) * vec4(fragColor, 1.0)) + (draw.colorTextureBlending * texture(texSampler, fragTexCoord));
+	}
 }
@@ -6,11 +6,11 @@
  * fragment shader.
  */
 
-layout(binding = 0) uniform ModelViewPerspective {
-    mat4 model;
-    mat4 view;
-    mat4 proj;
-} mvp;
+/* Per-draw data, the MVP is combined on the CPU so a single matrix-vector product is done per vertex */
+layout(push_constant) uniform DrawPushConstants {
+    mat4 mvp;
+    float colorTextureBlending;
+} draw;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -21,7 +21,7 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = mvp.proj * mvp.view * mvp.model * vec4(inPosition, 1.0);
+    gl_Position = draw.mvp * vec4(inPosition, 1.0);
     fragColor = inColor;
 	// fragColor = inNormal;
     fragTexCoord = inTexCoord;
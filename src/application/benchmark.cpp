@@ -0,0 +1,160 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+/* Frames rendered before and during the measure of each instance count */
+static const uint32_t BENCHMARK_WARMUP_FRAMES = 10;
+static const uint32_t BENCHMARK_FRAMES = 100;
+/* Scene objects drawn by the recording benchmark, each one a draw call with its own push constants */
+static const uint32_t RECORDING_BENCHMARK_OBJECTS = 64 * 1024;
+
+/*
+ * Draw 1, 10, ..., 1M instances of the object, laid out in a cube of fixed size, and print the mean frame time of each count.
+ * Every count is a single draw call, so the frame time only grows with the vertex work and the per-frame instance upload.
+ * Also prints how many of the measured frames recorded their command buffer instead of submitting a cached one,
+ * how many were drawn with a fallback pipeline while their variant was compiling, and the mean latency of the frames.
+ */
+void Application::runInstanceBenchmark() {
+	std::cout << "instances\tms/frame\tinstances/s\trecorded\tfallback\tlatency ms" << std::endl;
+
+	for (uint32_t count = 1; count <= 1000000; count *= 10) {
+		/* Smallest cube holding every instance, scaled to keep the same size on screen */
+		uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+		float spacing = 4.0f / static_cast<float>(side);
+		float center = static_cast<float>(side - 1) * 0.5f;
+
+		this->object->clearInstances();
+		this->object->reserveInstances(count);
+		for (uint32_t i = 0; i < count; i++) {
+			float x = static_cast<float>(i % side);
+			float y = static_cast<float>((i / side) % side);
+			float z = static_cast<float>(i / (side * side));
+
+			ft::mat4 model = ft::translate(ft::vec3((x - center) * spacing, (y - center) * spacing, (z - center) * spacing))
+				* ft::scale(ft::vec3(spacing * 0.5f, spacing * 0.5f, spacing * 0.5f));
+			ft::vec4 color(x / side, y / side, z / side, 1.0f);
+			/* Half of the instances are untextured to exercise both paths of the shader */
+			this->object->addInstance(model, color, i % 2 == 0 ? 0 : NO_TEXTURE);
+		}
+
+		for (uint32_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES && !glfwWindowShouldClose(this->window); frame++) {
+			glfwPollEvents();
+			this->drawFrame();
+		}
+
+		uint64_t recordedBefore = this->commandBufferCache.getRecordedCount();
+		uint64_t fallbackBefore = this->fallbackPipelineFrameCount;
+		FramePacing pacingBefore = this->framePacing;
+		auto start = std::chrono::high_resolution_clock::now();
+		uint32_t frames = 0;
+		for (; frames < BENCHMARK_FRAMES && !glfwWindowShouldClose(this->window); frames++) {
+			glfwPollEvents();
+			this->drawFrame();
+		}
+		/* Count the GPU work of the last frames too */
+		vkDeviceWaitIdle(this->device);
+		auto end = std::chrono::high_resolution_clock::now();
+		/* The device is idle, compact the holes left by the instance buffers outgrown so far */
+		this->defragmentInstanceBuffers();
+
+		if (frames == 0) {
+			break;
+		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+		uint64_t pacedFrames = this->framePacing.frames - pacingBefore.frames;
+		double latency = pacedFrames > 0 ? (this->framePacing.latencyMilliseconds - pacingBefore.latencyMilliseconds) / pacedFrames : 0.0;
+		std::cout << count << "\t\t" << std::fixed << std::setprecision(3) << milliseconds
+			<< "\t\t" << std::setprecision(0) << (count / milliseconds * 1000.0)
+			<< "\t" << (this->commandBufferCache.getRecordedCount() - recordedBefore) << "/" << frames
+			<< "\t\t" << (this->fallbackPipelineFrameCount - fallbackBefore) << "/" << frames
+			<< "\t\t" << std::setprecision(3) << latency << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	this->object->clearInstances();
+	vkDeviceWaitIdle(this->device);
+}
+
+/*
+ * Replace the scene by RECORDING_BENCHMARK_OBJECTS copies of the model, laid out in a cube of fixed size, each one a direct draw,
+ * and print the mean time spent recording the command buffer of a frame when its draws are split in 1, 2, 4, ... chunks,
+ * up to one chunk per recording thread. The command buffers are recorded every frame, none is taken from the cache.
+ */
+void Application::runRecordingBenchmark() {
+	std::vector<SceneObject> objects = this->scene.getObjects();
+	bool indirectDrawEnabled = this->indirectDrawEnabled;
+	/* The indirect draws are submitted by a single call, only the direct ones are split in chunks */
+	this->indirectDrawEnabled = false;
+
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(RECORDING_BENCHMARK_OBJECTS))));
+	float spacing = 4.0f / static_cast<float>(side);
+	float center = static_cast<float>(side - 1) * 0.5f;
+
+	this->scene.clearObjects();
+	for (uint32_t i = 0; i < RECORDING_BENCHMARK_OBJECTS; i++) {
+		float x = static_cast<float>(i % side);
+		float y = static_cast<float>((i / side) % side);
+		float z = static_cast<float>(i / (side * side));
+
+		SceneObject copy = objects[0];
+		copy.position = ft::vec3((x - center) * spacing, (y - center) * spacing, (z - center) * spacing);
+		copy.scale = ft::vec3(spacing * 0.5f, spacing * 0.5f, spacing * 0.5f);
+		copy.instanced = false;
+		this->scene.addObject(copy);
+	}
+
+	std::cout << "chunks	draws		record ms	draws/s		speedup" << std::endl;
+
+	/* Powers of two, then every recording thread */
+	std::vector<uint32_t> chunkCounts;
+	for (uint32_t chunks = 1; chunks < this->recordingChunkCount; chunks *= 2) {
+		chunkCounts.push_back(chunks);
+	}
+	chunkCounts.push_back(this->recordingChunkCount);
+
+	double singleChunkMilliseconds = 0.0;
+	for (uint32_t chunks : chunkCounts) {
+		this->recordingChunkLimit = chunks;
+
+		for (uint32_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES && !glfwWindowShouldClose(this->window); frame++) {
+			glfwPollEvents();
+			this->commandBufferCache.invalidate();
+			this->drawFrame();
+		}
+
+		double recordingBefore = this->recordingMilliseconds;
+		uint32_t frames = 0;
+		for (; frames < BENCHMARK_FRAMES && !glfwWindowShouldClose(this->window); frames++) {
+			glfwPollEvents();
+			this->commandBufferCache.invalidate();
+			this->drawFrame();
+		}
+
+		if (frames == 0) {
+			break;
+		}
+
+		/* The objects outside the view frustum are culled on the CPU, only the others are recorded */
+		size_t draws = this->renderQueue.getItems().size();
+		double milliseconds = (this->recordingMilliseconds - recordingBefore) / frames;
+		if (chunks == 1) {
+			singleChunkMilliseconds = milliseconds;
+		}
+		std::cout << chunks << "\t" << draws << "\t\t" << std::fixed << std::setprecision(3) << milliseconds
+			<< "\t\t" << std::setprecision(0) << (draws / milliseconds * 1000.0)
+			<< "\t" << std::setprecision(2) << (singleChunkMilliseconds / milliseconds) << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	vkDeviceWaitIdle(this->device);
+	this->recordingChunkLimit = UINT32_MAX;
+	this->indirectDrawEnabled = indirectDrawEnabled;
+	this->scene.clearObjects();
+	for (const SceneObject& object : objects) {
+		this->scene.addObject(object);
+	}
+}
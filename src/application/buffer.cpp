@@ -1,11 +1,28 @@
 #include "application.hpp"
 
-/* TODO: It should be noted that in a real world application, you're not supposed to actually call vkAllocateMemory for every individual buffer.
+/* In a real world application, you're not supposed to actually call vkAllocateMemory for every individual buffer.
  * The maximum number of simultaneous memory allocations is limited by the maxMemoryAllocationCount physical device limit, which may be as low as 4096 even on high end hardware like an NVIDIA GTX 1080.
- * The right way to allocate memory for a large number of objects at the same time is to create a custom allocator
- * that splits up a single allocation among many different objects by using the offset parameters that we've seen in many functions.
- * This is known as "memory aliasing" and is a common strategy in Vulkan.
+ * So buffers and images get their memory from the MemoryAllocator, which splits up large allocations
+ * among many different objects by using the offset parameters of vkBindBufferMemory and vkBindImageMemory.
  */
+void Application::createAllocator() {
+	this->allocator.init(this->physicalDevice, this->device);
+	this->memoryTelemetry.init(this->physicalDevice, this->memoryBudgetSupported);
+}
+
+/*
+ * Write the heap budgets, the bytes per category and the allocator statistics to MEMORY_TELEMETRY_PATH.
+ * Called from a GLFW callback and before the teardown, so a failure is only reported.
+ */
+void Application::dumpMemoryTelemetry() {
+	try {
+		this->memoryTelemetry.dumpJson(MEMORY_TELEMETRY_PATH, this->allocator);
+	} catch (const std::exception& e) {
+		std::cerr << "Failed to write memory telemetry: " << e.what() << std::endl;
+		return;
+	}
+	std::cout << "Memory telemetry written to " << MEMORY_TELEMETRY_PATH << std::endl;
+}
 
 /*
  * Helper function to create a buffer.
@@ -21,13 +38,20 @@
  * 	VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT: Memory is visible to the host (CPU).
  * 	VK_MEMORY_PROPERTY_HOST_COHERENT_BIT: Allows mapping a memory region for persistant access.
  * 	VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT: Memory is only accessible by the GPU.
+ *
+ * With several sharingFamilies, the buffer is used by these queue families without ownership transfers.
  */
-void Application::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void Application::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory, AllocationStrategy strategy, const std::vector<uint32_t>& sharingFamilies) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (sharingFamilies.size() > 1) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharingFamilies.size());
+		bufferInfo.pQueueFamilyIndices = sharingFamilies.data();
+	}
 
     if (vkCreateBuffer(this->device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
@@ -37,22 +61,18 @@ void Application::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMe
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(this->device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = this->findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(this->device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
+	uint32_t memoryTypeIndex = this->findMemoryType(memRequirements.memoryTypeBits, properties);
+	/* The usage tells what the memory is for in the telemetry */
+	uint32_t category = static_cast<uint32_t>(bufferMemoryCategory(usage));
+	bufferMemory = this->allocator.allocate(memRequirements, memoryTypeIndex, ResourceTiling::Linear, strategy, nullptr, category);
 
-	/* Bind the vertex buffer to the allocated memory */
-    vkBindBufferMemory(this->device, buffer, bufferMemory, 0);
+	/* Bind the vertex buffer to its range of the allocated memory */
+    vkBindBufferMemory(this->device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 uint32_t Application::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(this->physicalDevice, &memProperties);
+	/* Cached by the allocator, the memory properties of a device do not change */
+	const VkPhysicalDeviceMemoryProperties& memProperties = this->allocator.getMemoryProperties();
 
 	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
 		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
@@ -63,14 +83,23 @@ uint32_t Application::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags
 	throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void Application::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-	/* TODO: create a permanent command buffer for this (using VK_COMMAND_POOL_CREATE_TRANSIENT_BIT) */
-	
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+/*
+ * The copy is only recorded in the current batch of uploads, it is executed at the next flushUploads().
+ */
+void Application::copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size) {
+	/* A copy (or a barrier) of 0 bytes is invalid, e.g. for a mesh without indices */
+	if (size == 0) {
+		return;
+	}
+
+	VkCommandBuffer commandBuffer = this->uploadContext.commandBuffer();
 
     VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(commandBuffer);
+	/* Make the copy visible to the graphics queue when it runs on the transfer queue */
+	this->uploadContext.releaseBuffer(dstBuffer, dstOffset, size);
 }
\ No newline at end of file
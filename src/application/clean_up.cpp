@@ -12,61 +12,117 @@ static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMesse
 	}
 }
 
+/*
+ * Retire everything created with the swap chain: the frames in flight may still use it, it is destroyed once they are complete.
+ * The swap chain handle is kept, to be given as oldSwapchain to its replacement.
+ */
 void Application::cleanupSwapChain() {
-	vkDestroyImageView(this->device, this->depthImageView, nullptr);
-    vkDestroyImage(this->device, this->depthImage, nullptr);
-    vkFreeMemory(this->device, this->depthImageMemory, nullptr);
-
-	for (size_t i = 0; i < this->swapChainFramebuffers.size(); i++) {
-		vkDestroyFramebuffer(this->device, this->swapChainFramebuffers[i], nullptr);
+	if (this->occlusionCullingSupported) {
+		this->destroyDepthPyramidImage();
 	}
 
-	for (size_t i = 0; i < this->swapChainImageViews.size(); i++) {
-		vkDestroyImageView(this->device, this->swapChainImageViews[i], nullptr);
-	}
-
-	vkDestroySwapchainKHR(this->device, this->swapChain, nullptr);
+	VkImageView depthImageView = this->depthImageView;
+	VkImage depthImage = this->depthImage;
+	Allocation depthImageMemory = this->depthImageMemory;
+	std::vector<VkFramebuffer> framebuffers = std::move(this->swapChainFramebuffers);
+	std::vector<VkImageView> imageViews = std::move(this->swapChainImageViews);
+	VkSwapchainKHR swapChain = this->swapChain;
+	this->swapChainFramebuffers.clear();
+	this->swapChainImageViews.clear();
+
+	this->deletionQueue.push(this->submittedFrameCount, [this, depthImageView, depthImage, depthImageMemory, framebuffers, imageViews, swapChain]() mutable {
+		vkDestroyImageView(this->device, depthImageView, nullptr);
+		vkDestroyImage(this->device, depthImage, nullptr);
+		this->allocator.free(depthImageMemory);
+
+		for (VkFramebuffer framebuffer : framebuffers) {
+			vkDestroyFramebuffer(this->device, framebuffer, nullptr);
+		}
+
+		for (VkImageView imageView : imageViews) {
+			vkDestroyImageView(this->device, imageView, nullptr);
+		}
+
+		vkDestroySwapchainKHR(this->device, swapChain, nullptr);
+	});
 }
 
 void Application::cleanup() {
+	/* Last picture of the memory, while everything is still allocated */
+	this->dumpMemoryTelemetry();
+
 	this->cleanupSwapChain();
+	/* The device is idle, and the command buffers retired with the previous swap chains must be freed before their pools */
+	this->deletionQueue.flush();
+
+	this->uploadContext.destroy();
 
 	vkDestroySampler(device, textureSampler, nullptr);
 
 	vkDestroyImageView(this->device, this->textureImageView, nullptr);
 
 	vkDestroyImage(this->device, this->textureImage, nullptr);
-    vkFreeMemory(this->device, this->textureImageMemory, nullptr);
+    this->allocator.free(this->textureImageMemory);
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroyBuffer(this->device, this->uniformBuffers[i], nullptr);
-        vkFreeMemory(this->device, this->uniformBuffersMemory[i], nullptr);
+	vkDestroyBuffer(this->device, this->uniformArenaBuffer, nullptr);
+	this->allocator.free(this->uniformArenaMemory);
 
-		vkDestroyBuffer(this->device, this->textureEnabledBuffers[i], nullptr);
-		vkFreeMemory(this->device, this->textureEnabledBufferMemory[i], nullptr);
-    }
+	for (uint32_t i = 0; i < this->instanceBuffers.size(); i++) {
+		this->destroyInstanceBuffer(i);
+	}
+
+	this->destroyDepthPyramid();
+	this->destroyCullingResources();
+
+	vkDestroyBuffer(this->device, this->drawDataBuffer, nullptr);
+	this->allocator.free(this->drawDataMemory);
+	vkDestroyBuffer(this->device, this->indirectCommandBuffer, nullptr);
+	this->allocator.free(this->indirectCommandMemory);
 
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
+	/* Geometry pool */
 	vkDestroyBuffer(this->device, this->indexBuffer, nullptr);
-    vkFreeMemory(this->device, this->indexBufferMemory, nullptr);
+    this->allocator.free(this->indexBufferMemory);
 
 	vkDestroyBuffer(this->device, this->vertexBuffer, nullptr);
-	vkFreeMemory(this->device, this->vertexBufferMemory, nullptr);
+	this->allocator.free(this->vertexBufferMemory);
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	vkDestroyBuffer(this->device, this->stagingRingBuffer, nullptr);
+	this->allocator.free(this->stagingRingMemory);
+
+	for (size_t i = 0; i < this->framesInFlight; i++) {
 		vkDestroySemaphore(this->device, this->renderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(this->device, this->imageAvailableSemaphores[i], nullptr);
 		vkDestroyFence(this->device, this->inFlightFences[i], nullptr);
 	}
 
+	/* Frees the command buffers allocated from them */
+	this->destroySecondaryCommandPools();
 	vkDestroyCommandPool(this->device, this->commandPool, nullptr);
 
-	vkDestroyPipeline(this->device, this->graphicsPipeline, nullptr);
+	/* The workers may still be creating variants with the layout and the pipeline cache */
+	this->waitPipelineCompilations();
+	/* The fast-linked pipelines replaced by the last compilations */
+	this->deletionQueue.flush();
+	std::cout << "Frames drawn with a fallback pipeline: " << this->fallbackPipelineFrameCount << std::endl;
+	this->logFramePacing();
+	for (uint32_t i = 0; i < SHADING_MODE_COUNT; i++) {
+		vkDestroyPipeline(this->device, this->indirectPipelines[i], nullptr);
+		vkDestroyPipeline(this->device, this->instancedPipelines[i], nullptr);
+		vkDestroyPipeline(this->device, this->graphicsPipelines[i], nullptr);
+	}
+	this->destroyPipelineLibraries();
 	vkDestroyPipelineLayout(this->device, this->pipelineLayout, nullptr);
+	/* Holds every pipeline created by this run */
+	this->destroyPipelineCache();
+	vkDestroyRenderPass(this->device, this->lateRenderPass, nullptr);
+	vkDestroyRenderPass(this->device, this->earlyRenderPass, nullptr);
 	vkDestroyRenderPass(this->device, this->renderPass, nullptr);
 
+	this->allocator.destroy();
+
 	vkDestroyDevice(this->device, nullptr);
 
 	if (enableValidationLayers) {
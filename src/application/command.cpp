@@ -13,10 +13,16 @@ void Application::createCommandPool() {
 	if (vkCreateCommandPool(this->device, &poolInfo, nullptr, &this->commandPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create command pool!");
 	}
+
+	this->createSecondaryCommandPools();
 }
 
+/*
+ * One command buffer per frame in flight and swap chain image: the frame selects its regions of the per-frame buffers
+ * and the image its framebuffer, so a command buffer recorded once can be submitted again by the same frame for the same image.
+ */
 void Application::createCommandBuffers() {
-	this->commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	this->commandBuffers.resize(this->framesInFlight * this->swapChainImages.size());
 
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -32,6 +38,69 @@ void Application::createCommandBuffers() {
 	if (vkAllocateCommandBuffers(this->device, &allocInfo, this->commandBuffers.data()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate command buffers!");
 	}
+
+	this->allocateSecondaryCommandBuffers();
+
+	/* Nothing recorded yet */
+	this->commandBufferCache.resize(this->commandBuffers.size());
+}
+
+/*
+ * Retired to the deletion queue: they may be pending in the frames in flight.
+ */
+void Application::destroyCommandBuffers() {
+	std::vector<VkCommandBuffer> primaries = std::move(this->commandBuffers);
+	std::vector<VkCommandBuffer> secondaries = std::move(this->secondaryCommandBuffers);
+	size_t imageCount = this->swapChainImages.size();
+	this->commandBuffers.clear();
+	this->secondaryCommandBuffers.clear();
+
+	this->deletionQueue.push(this->submittedFrameCount, [this, primaries, secondaries, imageCount] {
+		this->freeSecondaryCommandBuffers(secondaries, imageCount);
+		vkFreeCommandBuffers(this->device, this->commandPool, static_cast<uint32_t>(primaries.size()), primaries.data());
+	});
+}
+
+/*
+ * Everything recordCommandBuffer reads for the current frame. The matrices of the indirect draws and the culling planes
+ * are written in buffers every frame, so only the number of indirect draws is part of it.
+ * The draws with push constants are recorded with their MVP: they are recorded again when they move or the camera does.
+ *
+ * The handles created with the swap chain are not part of it, the cache is reset when it is recreated.
+ */
+void Application::buildRecordingState(RecordingState& state) {
+	state.clear();
+	state.add(this->indirectDrawEnabled);
+	state.add(this->gpuCullingEnabled);
+	state.add(this->occlusionCullingEnabled);
+	state.add(this->shadingMode);
+	/* Replaced by their optimized link with the pipeline libraries */
+	state.add(this->graphicsPipelines[this->shadingMode]);
+	state.add(this->instancedPipelines[this->shadingMode]);
+	state.add(this->indirectPipelines[this->shadingMode]);
+	/* Dynamic offset of the culling pass */
+	state.add(this->frameUniformsOffset);
+	state.add(this->drawDataOffset);
+	state.add(this->frameInstanceCount);
+	/* Replaced when it grows */
+	state.add(this->instanceBuffers[this->currentFrame]);
+	state.add(this->indirectDraws.drawCount());
+
+	const std::vector<SceneObject>& objects = this->scene.getObjects();
+	for (const DrawItem& item : this->renderQueue.getItems()) {
+		uint32_t pipeline = RenderQueue::keyPipeline(item.key);
+		if (pipeline == PIPELINE_INDIRECT) {
+			continue;
+		}
+
+		const Mesh& mesh = this->scene.getMesh(objects[item.index].mesh);
+		state.add(pipeline);
+		/* The bytes given to vkCmdPushConstants */
+		state.add(&this->drawPushConstants[item.index], sizeof(DrawPushConstants));
+		state.add(mesh.indexCount);
+		state.add(mesh.firstIndex);
+		state.add(mesh.firstVertex);
+	}
 }
 
 void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
@@ -43,7 +112,8 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	 * VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: This is a secondary command buffer that will be entirely within a single render pass.
 	 * VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT: The command buffer can be resubmitted while it is also already pending execution.
 	 */
-	beginInfo.flags = 0; // Optional
+	/* Not one time submit: the command buffer is submitted again as long as what it was recorded from does not change */
+	beginInfo.flags = 0;
 	/* Only for secondary command buffers */
 	beginInfo.pInheritanceInfo = nullptr; // Optional
 
@@ -51,9 +121,98 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 		throw std::runtime_error("failed to begin recording command buffer!");
 	}
 
+	/* The culling compute pass writes the indirect commands drawn in the render pass */
+	bool culling = this->indirectDrawEnabled && this->gpuCullingEnabled;
+	/* With the occlusion culling, only the draws visible last frame are drawn by the first pass */
+	bool occlusion = culling && this->occlusionCullingEnabled;
+	if (culling) {
+		this->recordCulling(commandBuffer, CULL_PHASE_EARLY);
+	}
+
+	/* The indirect draws are sorted last, they are submitted by a single call */
+	const std::vector<DrawItem>& items = this->renderQueue.getItems();
+	size_t directDrawCount = 0;
+	while (directDrawCount < items.size() && RenderQueue::keyPipeline(items[directDrawCount].key) != PIPELINE_INDIRECT) {
+		directDrawCount++;
+	}
+
+	/* Large draw lists are recorded by several threads in secondary command buffers */
+	VkRenderPass scenePass = occlusion ? this->earlyRenderPass : this->renderPass;
+	uint32_t chunkCount = static_cast<uint32_t>(std::min<size_t>(std::min(this->recordingChunkCount, this->recordingChunkLimit), directDrawCount / MIN_DRAWS_PER_RECORDING_CHUNK));
+	if (chunkCount > 1) {
+		this->beginScenePass(commandBuffer, scenePass, imageIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		this->recordDrawsInParallel(commandBuffer, scenePass, imageIndex, directDrawCount, chunkCount);
+	} else {
+		this->beginScenePass(commandBuffer, scenePass, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+		this->recordDraws(commandBuffer, items.data(), items.data() + items.size());
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	/* The other draws are tested against the depth of the first pass, only the visible ones are drawn */
+	if (occlusion) {
+		this->recordDepthPyramid(commandBuffer);
+		this->recordCulling(commandBuffer, CULL_PHASE_LATE);
+
+		this->beginScenePass(commandBuffer, this->lateRenderPass, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+		this->recordIndirectDraws(commandBuffer, this->culledRegionOffset(CULL_PHASE_LATE));
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+}
+
+/*
+ * Record the draws [begin, end) of the render queue, in the primary command buffer or in a secondary one.
+ * Only reads the state of the frame, so several threads can record different ranges at the same time.
+ */
+void Application::recordDraws(VkCommandBuffer commandBuffer, const DrawItem* begin, const DrawItem* end) {
+	/* The draws are sorted by pipeline first, so each pipeline is bound once */
+	uint32_t boundPipeline = UINT32_MAX;
+	for (const DrawItem* draw = begin; draw != end; draw++) {
+		const DrawItem& item = *draw;
+		uint32_t pipeline = RenderQueue::keyPipeline(item.key);
+		/* Every indirect draw was written in the indirect buffer, they are all submitted by a single call */
+		if (pipeline == PIPELINE_INDIRECT) {
+			if (boundPipeline != PIPELINE_INDIRECT) {
+				this->recordIndirectDraws(commandBuffer, this->culledRegionOffset(CULL_PHASE_EARLY));
+				boundPipeline = PIPELINE_INDIRECT;
+			}
+			continue;
+		}
+
+		if (pipeline != boundPipeline) {
+			const std::array<VkPipeline, SHADING_MODE_COUNT>& variants = pipeline == PIPELINE_INSTANCED ? this->instancedPipelines : this->graphicsPipelines;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, variants[this->shadingMode]);
+
+			/* The per-instance attributes come from binding 1 */
+			if (pipeline == PIPELINE_INSTANCED) {
+				VkDeviceSize instanceOffset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 1, 1, &this->instanceBuffers[this->currentFrame], &instanceOffset);
+			}
+			boundPipeline = pipeline;
+		}
+
+		/* MVP and blend ratio of the draw */
+		vkCmdPushConstants(commandBuffer, this->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawPushConstants), &this->drawPushConstants[item.index]);
+
+		/* firstIndex and vertexOffset select the mesh in the geometry pool, every instance is drawn by this single call */
+		const Mesh& mesh = this->scene.getMesh(this->scene.getObjects()[item.index].mesh);
+		uint32_t instanceCount = pipeline == PIPELINE_INSTANCED ? this->frameInstanceCount : 1;
+		vkCmdDrawIndexed(commandBuffer, mesh.indexCount, instanceCount, mesh.firstIndex, static_cast<int32_t>(mesh.firstVertex), 0);
+	}
+}
+
+/*
+ * Begin a render pass drawing the scene in the swap chain image.
+ * With inline contents the states shared by every draw are set here, secondary command buffers set them themselves.
+ */
+void Application::beginScenePass(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, VkSubpassContents contents) {
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = this->renderPass;
+	renderPassInfo.renderPass = pass;
 	renderPassInfo.framebuffer = this->swapChainFramebuffers[imageIndex];
 	/* Specify the render area by setting the offset and extent fields */
 	renderPassInfo.renderArea.offset = {0, 0};
@@ -66,10 +225,17 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
+	if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+		this->bindSceneState(commandBuffer);
+	}
+}
 
+/*
+ * Dynamic states, geometry and descriptor sets shared by every draw of the scene.
+ */
+void Application::bindSceneState(VkCommandBuffer commandBuffer) {
 	/* We set viewport and scissor as dynamic state, so we need to set them before drawing */
 	VkViewport viewport{};
 	viewport.x = 0.0f;
@@ -85,12 +251,8 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	scissor.extent = this->swapChainExtent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	/* Bind the vertex buffer */
-	VkBuffer vertexBuffers[] = {this->vertexBuffer};
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	/* Bind the index buffer */
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	/* Bind the vertex and index buffers of the geometry pool, shared by every mesh */
+	this->geometryPool.bind(commandBuffer);
 
 	/*
 	 * vertexCount: The number of vertices to draw.
@@ -101,46 +263,7 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	// vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
 
 	/* Bind the descriptor sets */
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 1, &this->descriptorSets[this->currentFrame], 0, nullptr);
-	
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(this->object->getIndices().size()), 1, 0, 0, 0);
-
-	vkCmdEndRenderPass(commandBuffer);
-
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("failed to record command buffer!");
-	}
-}
-
-VkCommandBuffer Application::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    return commandBuffer;
-}
-
-void Application::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-
-    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	/* The dynamic offset selects this frame's region of the draw data */
+	/* All the pipelines share the layout, so the descriptor set and push constants stay valid across pipeline changes */
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 1, &this->descriptorSet, 1, &this->drawDataOffset);
 }
\ No newline at end of file
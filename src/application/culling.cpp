@@ -0,0 +1,303 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+/*
+ * Resources of the culling compute pass, created only if the graphics queue can run it:
+ * the bounds written by the CPU, the culled commands written by the GPU, and the compute pipeline.
+ * If the depth attachment can be sampled, also the pipeline testing the draws against the depth pyramid.
+ */
+void Application::createCullingResources() {
+	/* The dispatch is recorded in the graphics command buffer */
+	QueueFamilyIndices indices = this->findQueueFamilies(this->physicalDevice);
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	if (!this->indirectDrawSupported || !(queueFamilies[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+		return;
+	}
+
+	/* One sphere and object index per draw */
+	this->createBuffer(
+		static_cast<VkDeviceSize>(MAX_INDIRECT_DRAWS) * this->framesInFlight * sizeof(CullBounds),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->cullBoundsBuffer,
+		this->cullBoundsMemory
+	);
+	/* Same layout as the indirect command buffer, only accessed by the GPU, twice: the late phase of the occlusion culling writes after the early one */
+	this->createBuffer(
+		this->culledRegionOffset(CULL_PHASE_LATE) * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->culledCommandBuffer,
+		this->culledCommandMemory
+	);
+
+	/* 0: commands written by the CPU, 1: bounds, 2: culled commands, 3: frame uniforms (frustum planes) */
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 3 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(this->device, &layoutInfo, nullptr, &this->cullDescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling descriptor set layout!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = 3;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(this->device, &poolInfo, nullptr, &this->cullDescriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = this->cullDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &this->cullDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(this->device, &allocInfo, &this->cullDescriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate culling descriptor set!");
+	}
+
+	/* Whole buffers, the frame regions are selected with the offsets of the push constants, and the frame uniforms with the dynamic offset */
+	std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+	bufferInfos[0].buffer = this->indirectCommandBuffer;
+	bufferInfos[1].buffer = this->cullBoundsBuffer;
+	bufferInfos[2].buffer = this->culledCommandBuffer;
+	bufferInfos[3].buffer = this->uniformArenaBuffer;
+
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+	for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = i == 3 ? sizeof(FrameUniforms) : VK_WHOLE_SIZE;
+
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = this->cullDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = bindings[i].descriptorType;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(this->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &this->cullDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device, &pipelineLayoutInfo, nullptr, &this->cullPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling pipeline layout!");
+	}
+
+	VkShaderModule computeShaderModule = this->loadShaderModule("shaders/cull.comp");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = computeShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = this->cullPipelineLayout;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (vkCreateComputePipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, &this->cullPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling pipeline!");
+	}
+	this->logPipelineCreation("shaders/cull.comp", start);
+
+	vkDestroyShaderModule(this->device, computeShaderModule, nullptr);
+
+	this->gpuCullingSupported = true;
+	this->gpuCullingEnabled = true;
+
+	if (!this->isDepthFormatSampleable()) {
+		return;
+	}
+
+	/* Visibility of each object in the last frame, starts with nothing visible */
+	this->createBuffer(
+		static_cast<VkDeviceSize>(MAX_INDIRECT_DRAWS) * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->cullVisibilityBuffer,
+		this->cullVisibilityMemory
+	);
+	memset(this->cullVisibilityMemory.mapped, 0, static_cast<size_t>(MAX_INDIRECT_DRAWS) * sizeof(uint32_t));
+
+	/* 1: depth pyramid, 2: visibility, the view and projection are read from the frame uniforms of set 0 */
+	std::array<VkDescriptorSetLayoutBinding, 2> occlusionBindings{};
+	occlusionBindings[0].binding = 1;
+	occlusionBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	occlusionBindings[1].binding = 2;
+	occlusionBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	for (VkDescriptorSetLayoutBinding& binding : occlusionBindings) {
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		binding.pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo occlusionLayoutInfo{};
+	occlusionLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	occlusionLayoutInfo.bindingCount = static_cast<uint32_t>(occlusionBindings.size());
+	occlusionLayoutInfo.pBindings = occlusionBindings.data();
+
+	if (vkCreateDescriptorSetLayout(this->device, &occlusionLayoutInfo, nullptr, &this->occlusionDescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling descriptor set layout!");
+	}
+
+	/* The set is allocated and written with the depth pyramid, which is recreated with the swap chain */
+
+	/* Set 0 is shared with the frustum culling pipeline, set 1 holds what the occlusion test adds */
+	std::array<VkDescriptorSetLayout, 2> occlusionSetLayouts = {this->cullDescriptorSetLayout, this->occlusionDescriptorSetLayout};
+
+	VkPipelineLayoutCreateInfo occlusionPipelineLayoutInfo{};
+	occlusionPipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	occlusionPipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(occlusionSetLayouts.size());
+	occlusionPipelineLayoutInfo.pSetLayouts = occlusionSetLayouts.data();
+	occlusionPipelineLayoutInfo.pushConstantRangeCount = 1;
+	occlusionPipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device, &occlusionPipelineLayoutInfo, nullptr, &this->occlusionCullPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling pipeline layout!");
+	}
+
+	/* Same source as the frustum culling, compiled with OCCLUSION */
+	VkShaderModule occlusionShaderModule = this->loadShaderModule("shaders/cull.comp", {"OCCLUSION"});
+
+	pipelineInfo.stage.module = occlusionShaderModule;
+	pipelineInfo.layout = this->occlusionCullPipelineLayout;
+
+	start = std::chrono::high_resolution_clock::now();
+	if (vkCreateComputePipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, &this->occlusionCullPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling pipeline!");
+	}
+	this->logPipelineCreation("shaders/cull.comp (OCCLUSION)", start);
+
+	vkDestroyShaderModule(this->device, occlusionShaderModule, nullptr);
+
+	this->occlusionCullingSupported = true;
+	this->occlusionCullingEnabled = true;
+}
+
+/*
+ * Offset of the output region of a phase in the culled command buffer, the late phase writes after every early region.
+ */
+VkDeviceSize Application::culledRegionOffset(uint32_t phase) {
+	if (phase == CULL_PHASE_EARLY) {
+		return 0;
+	}
+	return IndirectDrawList<DrawData>::commandRegionSize(MAX_INDIRECT_DRAWS) * this->framesInFlight;
+}
+
+void Application::destroyCullingResources() {
+	if (!this->gpuCullingSupported) {
+		return;
+	}
+
+	if (this->occlusionCullingSupported) {
+		vkDestroyPipeline(this->device, this->occlusionCullPipeline, nullptr);
+		vkDestroyPipelineLayout(this->device, this->occlusionCullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(this->device, this->occlusionDescriptorSetLayout, nullptr);
+		vkDestroyBuffer(this->device, this->cullVisibilityBuffer, nullptr);
+		this->allocator.free(this->cullVisibilityMemory);
+	}
+
+	vkDestroyPipeline(this->device, this->cullPipeline, nullptr);
+	vkDestroyPipelineLayout(this->device, this->cullPipelineLayout, nullptr);
+	vkDestroyDescriptorPool(this->device, this->cullDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(this->device, this->cullDescriptorSetLayout, nullptr);
+
+	vkDestroyBuffer(this->device, this->culledCommandBuffer, nullptr);
+	this->allocator.free(this->culledCommandMemory);
+	vkDestroyBuffer(this->device, this->cullBoundsBuffer, nullptr);
+	this->allocator.free(this->cullBoundsMemory);
+}
+
+/*
+ * Test the draws of the frame against the view frustum on the GPU, outside of the render pass.
+ * The CPU only writes one command and one sphere per draw, the visibility tests and the compaction cost it nothing.
+ *
+ * With the occlusion culling, the early phase keeps the draws visible last frame and the late phase, recorded once
+ * the depth pyramid is built, the other draws which are not hidden. Each phase writes its own region.
+ */
+void Application::recordCulling(VkCommandBuffer commandBuffer, uint32_t phase) {
+	uint32_t drawCount = this->indirectDraws.drawCount();
+	if (drawCount == 0) {
+		return;
+	}
+
+	bool occlusion = this->occlusionCullingEnabled;
+	VkDeviceSize regionOffset = this->culledRegionOffset(phase);
+
+	/* Reset the count of the frame, incremented by the shader for each visible draw */
+	vkCmdFillBuffer(commandBuffer, this->culledCommandBuffer, regionOffset + this->indirectDraws.countOffset(), sizeof(uint32_t), 0);
+
+	/* Also orders the visibility written by the late phase of the previous frame before this phase reads it */
+	VkMemoryBarrier fillBarrier{};
+	fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+	CullPushConstants cull{};
+	cull.drawCount = drawCount;
+	cull.commandWord = static_cast<uint32_t>(this->indirectDraws.commandOffset() / sizeof(uint32_t));
+	cull.countWord = static_cast<uint32_t>(this->indirectDraws.countOffset() / sizeof(uint32_t));
+	cull.firstBounds = this->currentFrame * MAX_INDIRECT_DRAWS;
+	/* Compacting needs the draw count to be read from the buffer */
+	cull.compact = this->cmdDrawIndexedIndirectCount != nullptr ? 1 : 0;
+	cull.phase = phase;
+	cull.outputWord = static_cast<uint32_t>(regionOffset / sizeof(uint32_t));
+
+	VkPipelineLayout layout = occlusion ? this->occlusionCullPipelineLayout : this->cullPipelineLayout;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, occlusion ? this->occlusionCullPipeline : this->cullPipeline);
+	/* The dynamic offset selects this frame's frustum planes, view and projection in the uniform arena */
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &this->cullDescriptorSet, 1, &this->frameUniformsOffset);
+	if (occlusion) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 1, 1, &this->occlusionDescriptorSet, 0, nullptr);
+	}
+	vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &cull);
+	/* 64 invocations per workgroup, see shaders/cull.comp */
+	vkCmdDispatch(commandBuffer, (drawCount + 63) / 64, 1, 1);
+
+	/* The culled commands and their count are read by the indirect draws */
+	VkBufferMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	cullBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	cullBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	cullBarrier.buffer = this->culledCommandBuffer;
+	cullBarrier.offset = regionOffset + this->indirectDraws.countOffset();
+	cullBarrier.size = IndirectDrawList<DrawData>::commandRegionSize(MAX_INDIRECT_DRAWS);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &cullBarrier, 0, nullptr);
+}
@@ -3,10 +3,16 @@
 void Application::createDepthResources() {
 	VkFormat depthFormat = this->findDepthFormat();
 
+	/* Sampled to build the depth pyramid of the occlusion culling */
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (this->isDepthFormatSampleable()) {
+		usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
+
 	this->createImage(
 		this->swapChainExtent.width, this->swapChainExtent.height,
 		depthFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		this->depthImage, this->depthImageMemory
 	);
 	this->depthImageView = this->createImageView(this->depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
@@ -20,6 +26,12 @@ VkFormat Application::findDepthFormat() {
 	);
 }
 
+bool Application::isDepthFormatSampleable() {
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, this->findDepthFormat(), &props);
+	return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
 bool Application::hasStencilComponent(VkFormat format) {
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
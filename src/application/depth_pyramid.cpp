@@ -0,0 +1,322 @@
+#include "application.hpp"
+
+/*
+ * Sampler and reduction pipeline of the depth pyramid, created only if the occlusion culling is supported.
+ */
+void Application::createDepthPyramid() {
+	if (!this->occlusionCullingSupported) {
+		return;
+	}
+
+	/* Texels are read exactly, the culling picks the level itself */
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = static_cast<float>(MAX_DEPTH_PYRAMID_LEVELS);
+
+	if (vkCreateSampler(this->device, &samplerInfo, nullptr, &this->depthPyramidSampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid sampler!");
+	}
+
+	/* 0: level above (or the depth attachment), 1: level written */
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	for (VkDescriptorSetLayoutBinding& binding : bindings) {
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		binding.pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(this->device, &layoutInfo, nullptr, &this->depthReduceDescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduction descriptor set layout!");
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &this->depthReduceDescriptorSetLayout;
+
+	if (vkCreatePipelineLayout(this->device, &pipelineLayoutInfo, nullptr, &this->depthReducePipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduction pipeline layout!");
+	}
+
+	VkShaderModule computeShaderModule = this->loadShaderModule("shaders/depth_reduce.comp");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = computeShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = this->depthReducePipelineLayout;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (vkCreateComputePipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, &this->depthReducePipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduction pipeline!");
+	}
+	this->logPipelineCreation("shaders/depth_reduce.comp", start);
+
+	vkDestroyShaderModule(this->device, computeShaderModule, nullptr);
+
+	this->createDepthPyramidImage();
+}
+
+/*
+ * The pyramid follows the size of the depth attachment, it is recreated with the swap chain.
+ * Its first level is the largest power of two not larger than the attachment, so every level is exactly half the one above.
+ */
+void Application::createDepthPyramidImage() {
+	this->depthPyramidWidth = 1;
+	while (this->depthPyramidWidth * 2 <= this->swapChainExtent.width) {
+		this->depthPyramidWidth *= 2;
+	}
+	this->depthPyramidHeight = 1;
+	while (this->depthPyramidHeight * 2 <= this->swapChainExtent.height) {
+		this->depthPyramidHeight *= 2;
+	}
+	this->depthPyramidLevels = 1;
+	while ((std::max(this->depthPyramidWidth, this->depthPyramidHeight) >> this->depthPyramidLevels) > 0 && this->depthPyramidLevels < MAX_DEPTH_PYRAMID_LEVELS) {
+		this->depthPyramidLevels++;
+	}
+
+	this->createImage(
+		this->depthPyramidWidth, this->depthPyramidHeight,
+		VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->depthPyramidImage, this->depthPyramidMemory, this->depthPyramidLevels
+	);
+	this->depthPyramidView = this->createImageView(this->depthPyramidImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, this->depthPyramidLevels);
+	this->depthPyramidLevelViews.resize(this->depthPyramidLevels);
+	for (uint32_t level = 0; level < this->depthPyramidLevels; level++) {
+		this->depthPyramidLevelViews[level] = this->createImageView(this->depthPyramidImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1);
+	}
+
+	/*
+	 * A new pool for each pyramid: the sets of the previous one may still be bound by the frames in flight,
+	 * they can neither be written nor reset, and are given back with their pool by the deletion queue.
+	 * One reduction set per level, and the occlusion culling set.
+	 */
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = this->depthPyramidLevels + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = this->depthPyramidLevels;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = this->depthPyramidLevels + 1;
+
+	if (vkCreateDescriptorPool(this->device, &poolInfo, nullptr, &this->depthReduceDescriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduction descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(this->depthPyramidLevels, this->depthReduceDescriptorSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = this->depthReduceDescriptorPool;
+	allocInfo.descriptorSetCount = this->depthPyramidLevels;
+	allocInfo.pSetLayouts = layouts.data();
+
+	this->depthReduceDescriptorSets.resize(this->depthPyramidLevels);
+	if (vkAllocateDescriptorSets(this->device, &allocInfo, this->depthReduceDescriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate depth reduction descriptor sets!");
+	}
+
+	VkDescriptorSetAllocateInfo occlusionAllocInfo{};
+	occlusionAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	occlusionAllocInfo.descriptorPool = this->depthReduceDescriptorPool;
+	occlusionAllocInfo.descriptorSetCount = 1;
+	occlusionAllocInfo.pSetLayouts = &this->occlusionDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(this->device, &occlusionAllocInfo, &this->occlusionDescriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate occlusion culling descriptor set!");
+	}
+
+	/* The pyramid stays in the general layout, its levels are read and written by the same dispatches */
+	std::vector<VkDescriptorImageInfo> inputInfos(this->depthPyramidLevels);
+	std::vector<VkDescriptorImageInfo> outputInfos(this->depthPyramidLevels);
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	for (uint32_t level = 0; level < this->depthPyramidLevels; level++) {
+		inputInfos[level].sampler = this->depthPyramidSampler;
+		inputInfos[level].imageView = level == 0 ? this->depthImageView : this->depthPyramidLevelViews[level - 1];
+		inputInfos[level].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		outputInfos[level].sampler = VK_NULL_HANDLE;
+		outputInfos[level].imageView = this->depthPyramidLevelViews[level];
+		outputInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = this->depthReduceDescriptorSets[level];
+		write.descriptorCount = 1;
+
+		write.dstBinding = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &inputInfos[level];
+		descriptorWrites.push_back(write);
+
+		write.dstBinding = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		write.pImageInfo = &outputInfos[level];
+		descriptorWrites.push_back(write);
+	}
+
+	/* Every level, sampled by the occlusion culling */
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = this->depthPyramidSampler;
+	pyramidInfo.imageView = this->depthPyramidView;
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet pyramidWrite{};
+	pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	pyramidWrite.dstSet = this->occlusionDescriptorSet;
+	pyramidWrite.dstBinding = 1;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidWrite.descriptorCount = 1;
+	pyramidWrite.pImageInfo = &pyramidInfo;
+	descriptorWrites.push_back(pyramidWrite);
+
+	/* Visibility of the draws last frame, written by the culling */
+	VkDescriptorBufferInfo visibilityBufferInfo{};
+	visibilityBufferInfo.buffer = this->cullVisibilityBuffer;
+	visibilityBufferInfo.offset = 0;
+	visibilityBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet visibilityWrite{};
+	visibilityWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	visibilityWrite.dstSet = this->occlusionDescriptorSet;
+	visibilityWrite.dstBinding = 2;
+	visibilityWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	visibilityWrite.descriptorCount = 1;
+	visibilityWrite.pBufferInfo = &visibilityBufferInfo;
+	descriptorWrites.push_back(visibilityWrite);
+
+	vkUpdateDescriptorSets(this->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+/*
+ * Retired with the swap chain, the frames in flight may still build or sample it.
+ */
+void Application::destroyDepthPyramidImage() {
+	std::vector<VkImageView> levelViews = std::move(this->depthPyramidLevelViews);
+	VkImageView view = this->depthPyramidView;
+	VkImage image = this->depthPyramidImage;
+	Allocation memory = this->depthPyramidMemory;
+	VkDescriptorPool descriptorPool = this->depthReduceDescriptorPool;
+	this->depthPyramidLevelViews.clear();
+
+	this->deletionQueue.push(this->submittedFrameCount, [this, levelViews, view, image, memory, descriptorPool]() mutable {
+		for (VkImageView levelView : levelViews) {
+			vkDestroyImageView(this->device, levelView, nullptr);
+		}
+		vkDestroyImageView(this->device, view, nullptr);
+		vkDestroyImage(this->device, image, nullptr);
+		this->allocator.free(memory);
+		/* Frees the reduction and occlusion sets of this pyramid */
+		vkDestroyDescriptorPool(this->device, descriptorPool, nullptr);
+	});
+}
+
+void Application::destroyDepthPyramid() {
+	if (!this->occlusionCullingSupported) {
+		return;
+	}
+
+	vkDestroyPipeline(this->device, this->depthReducePipeline, nullptr);
+	vkDestroyPipelineLayout(this->device, this->depthReducePipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(this->device, this->depthReduceDescriptorSetLayout, nullptr);
+	vkDestroySampler(this->device, this->depthPyramidSampler, nullptr);
+}
+
+/*
+ * Build every level of the pyramid from the depth written by the early render pass, one dispatch per level.
+ * The depth attachment is sampled in between and given back to the late render pass.
+ */
+void Application::recordDepthPyramid(VkCommandBuffer commandBuffer) {
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (this->hasStencilComponent(this->findDepthFormat())) {
+		depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+
+	std::array<VkImageMemoryBarrier, 2> beginBarriers{};
+	/* The depth attachment is read by the first reduction */
+	beginBarriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	beginBarriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	beginBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	beginBarriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	beginBarriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	beginBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	beginBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	beginBarriers[0].image = this->depthImage;
+	beginBarriers[0].subresourceRange = {depthAspect, 0, 1, 0, 1};
+	/* The previous content of the pyramid, read by the culling of the previous frame, is dropped */
+	beginBarriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	beginBarriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	beginBarriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	beginBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	beginBarriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	beginBarriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	beginBarriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	beginBarriers[1].image = this->depthPyramidImage;
+	beginBarriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, this->depthPyramidLevels, 0, 1};
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(beginBarriers.size()), beginBarriers.data());
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->depthReducePipeline);
+
+	for (uint32_t level = 0; level < this->depthPyramidLevels; level++) {
+		uint32_t width = std::max(1u, this->depthPyramidWidth >> level);
+		uint32_t height = std::max(1u, this->depthPyramidHeight >> level);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->depthReducePipelineLayout, 0, 1, &this->depthReduceDescriptorSets[level], 0, nullptr);
+		/* 8x8 invocations per workgroup, see shaders/depth_reduce.comp */
+		vkCmdDispatch(commandBuffer, (width + 7) / 8, (height + 7) / 8, 1);
+
+		/* The level is read by the next reduction, and by the culling after the last one */
+		VkImageMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.image = this->depthPyramidImage;
+		levelBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+	}
+
+	/* The late render pass keeps testing and writing the depth */
+	VkImageMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = this->depthImage;
+	depthBarrier.subresourceRange = {depthAspect, 0, 1, 0, 1};
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+}
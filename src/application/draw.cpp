@@ -5,7 +5,22 @@
 
 void Application::drawFrame() {
 	/* Wait for the corresponding frame to be finished */
+	auto frameStart = std::chrono::high_resolution_clock::now();
 	vkWaitForFences(this->device, 1, &this->inFlightFences[this->currentFrame], VK_TRUE, UINT64_MAX);
+	this->measureFramePacing(frameStart);
+
+	/* The frame this one takes the place of is complete, and the frames submitted before it too */
+	if (this->submittedFrameCount + 1 >= this->framesInFlight) {
+		this->deletionQueue.collect(this->submittedFrameCount + 1 - this->framesInFlight);
+	}
+
+	/* Give back the staging memory of the uploads the GPU is done with */
+	this->uploadContext.collect();
+
+	/* Submit the uploads queued since the last frame (e.g. by worker threads), they are acquired on the graphics queue before this frame */
+	if (this->uploadContext.hasPendingUploads()) {
+		this->flushUploads();
+	}
 
 	/* Acquire an image from the swap chain */
 	uint32_t imageIndex;
@@ -20,15 +35,29 @@ void Application::drawFrame() {
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
-	/* Update the uniforms buffers */
-	this->updateMvpUniformBuffer(this->currentFrame);
-	this->updateTextureEnabledBuffer(this->currentFrame);
+	/* Write the uniforms of this frame in its region of the uniform arena, the GPU is done with the previous ones since we waited for the fence */
+	this->uniformArena.beginFrame(this->currentFrame);
+	this->frameUniformsOffset = this->updateFrameUniforms();
+	this->updateColorTextureBlending();
+
+	/* The instances of the object are drawn with a single draw call */
+	this->frameInstanceCount = this->updateInstanceBuffer(this->currentFrame);
+
+	this->buildRenderQueue();
 	
 	/* Reset the fence only if we are submitting work to prevent a deadlock */
 	vkResetFences(this->device, 1, &this->inFlightFences[this->currentFrame]);
 
-	vkResetCommandBuffer(this->commandBuffers[this->currentFrame], 0);
-	this->recordCommandBuffer(this->commandBuffers[this->currentFrame], imageIndex);
+	/* Only recorded again if something it was recorded from changed, otherwise the commands of a previous frame are submitted as they are */
+	size_t commandBufferIndex = this->currentFrame * this->swapChainImages.size() + imageIndex;
+	VkCommandBuffer commandBuffer = this->commandBuffers[commandBufferIndex];
+	this->buildRecordingState(this->recordingState);
+	if (!this->commandBufferCache.reuse(commandBufferIndex, this->recordingState)) {
+		auto recordingStart = std::chrono::high_resolution_clock::now();
+		vkResetCommandBuffer(commandBuffer, 0);
+		this->recordCommandBuffer(commandBuffer, imageIndex);
+		this->recordingMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordingStart).count();
+	}
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -40,7 +69,7 @@ void Application::drawFrame() {
 	submitInfo.pWaitDstStageMask = waitStages;
 	/* Specify which command buffers to actually submit for execution */
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &this->commandBuffers[this->currentFrame];
+	submitInfo.pCommandBuffers = &commandBuffer;
 	/* Specify which semaphores to signal once the command buffer(s) have finished execution */
 	VkSemaphore signalSemaphores[] = {this->renderFinishedSemaphores[this->currentFrame]};
 	submitInfo.signalSemaphoreCount = 1;
@@ -49,6 +78,8 @@ void Application::drawFrame() {
 	if (vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, this->inFlightFences[this->currentFrame]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	this->submittedFrameCount++;
+	this->frameStartTimes[this->currentFrame] = frameStart;
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -73,33 +104,114 @@ void Application::drawFrame() {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
 
-	this->currentFrame = (this->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	this->currentFrame = (this->currentFrame + 1) % this->framesInFlight;
 }
 
-void Application::updateMvpUniformBuffer(uint32_t currentImage) {
+/*
+ * Compute the push constants of every scene object and sort their draws by pipeline, material, mesh and depth.
+ * Without GPU culling, the objects outside the view frustum or hidden by the occluders are culled here and never reach the queue.
+ */
+void Application::buildRenderQueue() {
 	float time = this->getTime();
+	const std::vector<SceneObject>& objects = this->scene.getObjects();
 
-	/* TODO: remove this */
-	// Glm_ModelViewPerspective glm_mvp{};
-	// glm_mvp.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	// glm_mvp.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	// glm_mvp.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f);
+	this->renderQueue.clear();
+	this->drawPushConstants.resize(objects.size());
+	this->drawBounds.resize(objects.size());
+	this->frustumCuller.clear();
+	this->frustumCuller.reserve(objects.size());
 
-	/* To rotate an object around itself, we need to move it to the center, rotate it, and then move it to the new position */
-	ft::mat4 translateToOrigin = ft::translate(-this->object->getBaricenter());
-	ft::mat4 rotate = ft::rotate(time * ft::radians(90.0f), ft::vec3(0.0f, 1.0f, 0.0f));
-	ft::mat4 translateToPosition = ft::translate(this->object->position);
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		const SceneObject& object = objects[i];
+		const Material& material = this->scene.getMaterial(object.material);
 
-	ft::mat4 scale = ft::scale(ft::vec3(1.0f, 1.0f, 1.0f));
+		/* Per-draw data goes in push constants, the MVP is combined here once instead of for every vertex */
+		DrawPushConstants& draw = this->drawPushConstants[i];
+		ft::mat4 model = object.model(time);
+		draw.mvp = this->frameUniforms.viewProj * model;
+		draw.colorTextureBlending = material.textureIndex == NO_TEXTURE ? 0.0f : this->colorTextureBlending.ratio;
+
+		this->drawBounds[i] = object.worldBounds(this->scene.getMeshBounds(object.mesh), model);
+		this->frustumCuller.push(this->drawBounds[i]);
+	}
 
-	ModelViewPerspective mvp{};
-	mvp.model = translateToPosition * rotate * translateToOrigin * scale;
-	mvp.view = ft::lookAt(
+	/* The indirect draws are culled by the compute pass when it is enabled */
+	bool cpuCulling = !(this->indirectDrawEnabled && this->gpuCullingEnabled);
+	if (cpuCulling) {
+		/* Only worth spreading across threads for very large scenes */
+		if (this->cullingPool == nullptr && objects.size() >= 2 * FrustumCuller::MIN_PARALLEL_CHUNK) {
+			this->cullingPool = std::make_unique<ThreadPool>();
+		}
+		this->frustumCuller.cull(Frustum::fromMatrix(this->frameUniforms.viewProj), this->drawVisibility, this->cullingPool.get());
+
+		if (this->cpuOcclusionEnabled && this->scene.occluderCount() > 0) {
+			this->cullOccludedObjects();
+		}
+	}
+
+	uint32_t indirectDrawCount = 0;
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		const SceneObject& object = objects[i];
+
+		uint32_t pipeline = this->indirectDrawEnabled ? PIPELINE_INDIRECT : PIPELINE_DEFAULT;
+		if (object.instanced && this->frameInstanceCount > 0) {
+			pipeline = PIPELINE_INSTANCED;
+		}
+
+		/* The instances are spread around the object, its bounds do not cover them */
+		if (cpuCulling && pipeline != PIPELINE_INSTANCED && !this->drawVisibility[i]) {
+			continue;
+		}
+
+		/* The indirect buffers hold MAX_INDIRECT_DRAWS per frame, the draws past them take the direct path.
+			They are not culled by the compute pass, only by the CPU when it culls */
+		if (pipeline == PIPELINE_INDIRECT && indirectDrawCount++ >= MAX_INDIRECT_DRAWS) {
+			pipeline = PIPELINE_DEFAULT;
+		}
+
+		/* Only the order matters, the squared distance avoids a square root */
+		float depth = (object.position - this->camera.getPosition()).lengthSquared();
+
+		this->renderQueue.push(RenderQueue::makeKey(pipeline, object.material, object.mesh, depth), i);
+	}
+
+	this->renderQueue.sort();
+
+	if (this->indirectDrawEnabled) {
+		this->writeIndirectDraws();
+	}
+}
+
+/*
+ * Rasterize the occluders of the objects in the view frustum, then cull the visible objects hidden behind them.
+ * The instanced objects are neither occluders nor culled, their bounds do not cover the instances.
+ */
+void Application::cullOccludedObjects() {
+	const std::vector<SceneObject>& objects = this->scene.getObjects();
+
+	this->occlusionRasterizer.clear();
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		const SceneObject& object = objects[i];
+		if (this->drawVisibility[i] && !object.instanced && object.occluder != NO_OCCLUDER) {
+			this->occlusionRasterizer.rasterize(this->scene.getOccluder(object.occluder), this->drawPushConstants[i].mvp);
+		}
+	}
+
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		if (this->drawVisibility[i] && !objects[i].instanced && !this->occlusionRasterizer.isSphereVisible(this->drawBounds[i], this->frameUniforms.viewProj)) {
+			this->drawVisibility[i] = 0;
+		}
+	}
+}
+
+uint32_t Application::updateFrameUniforms() {
+	FrameUniforms& frame = this->frameUniforms;
+	frame.view = ft::lookAt(
 		this->camera.getPosition(), /* camera position */
 		this->camera.getTarget(), /* target position */
 		this->camera.getUp() /* up vector */
 	);
-	mvp.proj = ft::perspective<float>(
+	frame.proj = ft::perspective<float>(
 		ft::radians(45.0f), /* field of view in radians */
 		(float) swapChainExtent.width / (float) swapChainExtent.height, /* aspect ratio */
 		0.1f, /* near plane */
@@ -108,12 +220,18 @@ void Application::updateMvpUniformBuffer(uint32_t currentImage) {
 
 	/* GLM was originally designed for OpenGL, where the Y coordinate of the clip coordinates is inverted.
 		The easiest way to compensate for that is to flip the sign on the scaling factor of the Y axis in the projection matrix. */
-	mvp.proj[1][1] *= -1;
+	frame.proj[1][1] *= -1;
+
+	frame.viewProj = frame.proj * frame.view;
 
-	memcpy(this->uniformBuffersMapped[currentImage], &mvp, sizeof(mvp));
+	/* In the uniforms rather than in the commands, so the culling pass does not have to be recorded again when the camera moves */
+	Frustum frustum = Frustum::fromMatrix(frame.viewProj);
+	memcpy(frame.frustumPlanes, frustum.planes, sizeof(frame.frustumPlanes));
+
+	return this->uniformArena.push(frame);
 }
 
-void Application::updateTextureEnabledBuffer(uint32_t currentImage) {
+void Application::updateColorTextureBlending() {
 	static float lastFrameTime = this->getTime();
 	float currentFrameTime = this->getTime();
 
@@ -127,6 +245,21 @@ void Application::updateTextureEnabledBuffer(uint32_t currentImage) {
 		this->colorTextureBlending.ratio = fmax(0.0f, this->colorTextureBlending.ratio - deltaRatio);
 	}
 
+	/* Once the transition is over, the variant without the blend (and without the texture fetch for colors) draws the frame */
+	uint32_t shadingMode = SHADING_BLENDED;
+	if (this->colorTextureBlending.ratio <= 0.0f) {
+		shadingMode = SHADING_COLOR;
+	} else if (this->colorTextureBlending.ratio >= 1.0f) {
+		shadingMode = SHADING_TEXTURE;
+	}
+
+	/* The blended variants can draw any ratio, they stand in for the variants still compiled by the workers */
+	this->pollPipelineCompilations();
+	if (!this->isShadingModeReady(shadingMode)) {
+		shadingMode = SHADING_BLENDED;
+		this->fallbackPipelineFrameCount++;
+	}
+	this->shadingMode = shadingMode;
+
 	lastFrameTime = currentFrameTime;
-	memcpy(this->textureEnabledBufferMapped[currentImage], &this->colorTextureBlending, sizeof(this->colorTextureBlending));
-}
\ No newline at end of file
+}
@@ -0,0 +1,51 @@
+#include "application.hpp"
+
+#include <iomanip>
+
+/*
+ * Account the frame last submitted in the current frame in flight, whose fence was just waited for since frameStart.
+ * The slots which were not submitted yet (the first frames, or a frame skipped to recreate the swap chain) are not counted.
+ */
+void Application::measureFramePacing(std::chrono::high_resolution_clock::time_point frameStart) {
+	auto now = std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::time_point& submittedStart = this->frameStartTimes[this->currentFrame];
+	if (submittedStart == std::chrono::high_resolution_clock::time_point{}) {
+		return;
+	}
+
+	if (this->framePacing.frames == 0) {
+		this->framePacing.start = submittedStart;
+	}
+	this->framePacing.frames++;
+	this->framePacing.latencyMilliseconds += std::chrono::duration<double, std::milli>(now - submittedStart).count();
+	this->framePacing.fenceWaitMilliseconds += std::chrono::duration<double, std::milli>(now - frameStart).count();
+	this->framePacing.end = now;
+
+	submittedStart = std::chrono::high_resolution_clock::time_point{};
+}
+
+/*
+ * Print the mean frame time and latency since the last report: FIFO with more frames in flight raises the throughput
+ * of uneven frames but queues them behind the vertical blank, MAILBOX and IMMEDIATE keep the latency of a single frame.
+ */
+void Application::logFramePacing() {
+	const FramePacing& pacing = this->framePacing;
+	if (pacing.frames > 0) {
+		double frameMilliseconds = std::chrono::duration<double, std::milli>(pacing.end - pacing.start).count() / pacing.frames;
+		std::cout << "Frame pacing (" << getPresentModeName(this->swapChainPresentMode) << ", " << this->framesInFlight << " frames in flight): "
+			<< std::fixed << std::setprecision(3) << frameMilliseconds << " ms/frame (" << std::setprecision(1) << (1000.0 / frameMilliseconds) << " fps), "
+			<< std::setprecision(3) << (pacing.latencyMilliseconds / pacing.frames) << " ms latency, "
+			<< (pacing.fenceWaitMilliseconds / pacing.frames) << " ms waiting for the GPU, over " << pacing.frames << " frames" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+	this->framePacing = FramePacing{};
+}
+
+const char* Application::getPresentModeName(VkPresentModeKHR presentMode) {
+	for (uint32_t i = 0; i < PRESENT_MODE_COUNT; i++) {
+		if (PRESENT_MODES[i] == presentMode) {
+			return PRESENT_MODE_NAMES[i];
+		}
+	}
+	return "unknown";
+}
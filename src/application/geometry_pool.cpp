@@ -0,0 +1,56 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+/*
+ * Every mesh lives in the same vertex buffer and index buffer, so they are bound once per frame
+ * and each mesh is drawn with its own firstIndex and vertexOffset.
+ */
+void Application::createGeometryPool() {
+	/* Create the shared buffers:
+	 * VK_BUFFER_USAGE_TRANSFER_DST_BIT: Buffer can be used as destination in a memory transfer operation.
+	 * VK_BUFFER_USAGE_VERTEX_BUFFER_BIT / VK_BUFFER_USAGE_INDEX_BUFFER_BIT: Buffer can be used as vertex / index buffer.
+	 * VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT: Memory is only accessible by the GPU.
+	 * Meshes are copied into them on the transfer queue while the graphics queue draws the others, so they are shared by both families.
+	 */
+	std::vector<uint32_t> sharingFamilies = this->uploadContext.getSharingFamilies();
+	this->createBuffer(
+		GEOMETRY_POOL_MAX_VERTICES * sizeof(Vertex),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->vertexBuffer, this->vertexBufferMemory,
+		AllocationStrategy::Buddy, sharingFamilies
+	);
+	this->createBuffer(
+		GEOMETRY_POOL_MAX_INDICES * sizeof(uint32_t),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->indexBuffer, this->indexBufferMemory,
+		AllocationStrategy::Buddy, sharingFamilies
+	);
+
+	this->geometryPool.init(this->vertexBuffer, GEOMETRY_POOL_MAX_VERTICES, this->indexBuffer, GEOMETRY_POOL_MAX_INDICES);
+}
+
+/*
+ * Take room for the object in the geometry pool and queue the copy of its vertices and indices,
+ * the indices stay relative to the first vertex of the mesh.
+ * The copies are recorded by the next flushUploads().
+ */
+Mesh Application::uploadMesh(const Object& object) {
+	const Vertices& vertices = object.getVertices();
+	const std::vector<uint32_t>& indices = object.getIndices();
+
+	Mesh mesh = this->geometryPool.allocate(static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()));
+
+	VkDeviceSize vertexSize = sizeof(vertices[0]) * vertices.size();
+	this->uploadContext.enqueue(vertices.data(), vertexSize, 16, [this, mesh, vertexSize](const StagingRegion& staging) {
+		this->copyBuffer(staging.buffer, staging.offset, this->vertexBuffer, GeometryPool<Vertex>::vertexByteOffset(mesh), vertexSize);
+	});
+
+	VkDeviceSize indexSize = sizeof(indices[0]) * indices.size();
+	this->uploadContext.enqueue(indices.data(), indexSize, 16, [this, mesh, indexSize](const StagingRegion& staging) {
+		this->copyBuffer(staging.buffer, staging.offset, this->indexBuffer, GeometryPool<Vertex>::indexByteOffset(mesh), indexSize);
+	});
+
+	return mesh;
+}
@@ -1,12 +1,104 @@
 #include "application.hpp"
 #include "vertex.hpp"
 
+/*
+ * All the pipelines share the layout and every fixed function state, they only differ by their shaders and vertex input.
+ * Each one is created in every shading mode: the blended variant, which can draw any blend ratio, before the first frame,
+ * the others by worker threads (see pipeline_compilation.cpp).
+ */
 void Application::createGraphicsPipeline() {
-	auto vertShaderCode = this->readFile("shaders/vert.spv");
-	auto fragShaderCode = this->readFile("shaders/frag.spv");
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &this->descriptorSetLayout;
+	/* Per-draw data, read by both stages */
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawPushConstants);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device, &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	auto vertexAttributes = Vertex::getAttributeDescriptions();
+	std::vector<VkVertexInputAttributeDescription> attributes(vertexAttributes.begin(), vertexAttributes.end());
+
+	this->createPipelineVariants(
+		this->graphicsPipelines,
+		"shaders/shader.vert", "shaders/shader.frag",
+		{Vertex::getBindingDescription()},
+		attributes
+	);
+
+	this->createPipelineVariants(
+		this->indirectPipelines,
+		"shaders/indirect.vert", "shaders/indirect.frag",
+		{Vertex::getBindingDescription()},
+		attributes
+	);
+
+	/* The instanced pipeline reads a second vertex buffer, advanced once per instance */
+	auto instanceAttributes = InstanceData::getAttributeDescriptions();
+	attributes.insert(attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+
+	this->createPipelineVariants(
+		this->instancedPipelines,
+		"shaders/instanced.vert", "shaders/instanced.frag",
+		{Vertex::getBindingDescription(), InstanceData::getBindingDescription()},
+		attributes
+	);
+}
+
+/*
+ * The variants only differ by the SHADING_MODE specialization constant of the fragment shader:
+ * the driver removes the branches of the other modes, and the texture fetch of the color-only variant.
+ * The blended variant is the fallback of the others, it is created right away and the others are left to the workers.
+ */
+void Application::createPipelineVariants(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+	/* Every variant is ready right away, no fallback needed */
+	if (this->pipelineLibrarySupported) {
+		this->createPipelineVariantsFromLibraries(variants, vertPath, fragPath, bindingDescriptions, attributeDescriptions);
+		return;
+	}
+
+	VkShaderModule vertShaderModule = this->loadShaderModule(vertPath);
+	VkShaderModule fragShaderModule = this->loadShaderModule(fragPath);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	variants[SHADING_BLENDED] = this->createPipeline(vertShaderModule, fragShaderModule, SHADING_BLENDED, bindingDescriptions, attributeDescriptions);
+	this->logPipelineCreation(vertPath + " + " + fragPath + " (" + SHADING_MODE_NAMES[SHADING_BLENDED] + ")", start);
+
+	/* Clean up the shader modules */
+	vkDestroyShaderModule(this->device, fragShaderModule, nullptr);
+	vkDestroyShaderModule(this->device, vertShaderModule, nullptr);
+
+	for (uint32_t shadingMode = 0; shadingMode < SHADING_MODE_COUNT; shadingMode++) {
+		if (shadingMode != SHADING_BLENDED) {
+			this->compilePipelineAsync(variants, shadingMode, vertPath, fragPath, bindingDescriptions, attributeDescriptions);
+		}
+	}
+}
 
-	VkShaderModule vertShaderModule = this->createShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule = this->createShaderModule(fragShaderCode);
+/*
+ * Create a complete pipeline, or only the parts given by libraryFlags as a pipeline library:
+ * the state of the other parts is ignored by the driver, and the shader module of a stage outside the library is VK_NULL_HANDLE.
+ */
+VkPipeline Application::createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, uint32_t shadingMode, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions, VkGraphicsPipelineLibraryFlagsEXT libraryFlags) {
+	/* SHADING_MODE, constant_id 0 of the fragment shaders */
+	VkSpecializationMapEntry specializationEntry{};
+	specializationEntry.constantID = 0;
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(uint32_t);
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &specializationEntry;
+	specializationInfo.dataSize = sizeof(uint32_t);
+	specializationInfo.pData = &shadingMode;
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -20,19 +112,23 @@ void Application::createGraphicsPipeline() {
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
-	VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	if (vertShaderModule != VK_NULL_HANDLE) {
+		shaderStages.push_back(vertShaderStageInfo);
+	}
+	if (fragShaderModule != VK_NULL_HANDLE) {
+		shaderStages.push_back(fragShaderStageInfo);
+	}
 
 	/* Specify the format of the vertex data passed to the vertex shader */
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	/* Specify dynamic state that can be changed without recreating the pipeline. Here we specify the viewport and scissor rectangle */
@@ -130,17 +226,6 @@ void Application::createGraphicsPipeline() {
 	colorBlending.blendConstants[2] = 0.0f; // Optional
 	colorBlending.blendConstants[3] = 0.0f; // Optional
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &this->descriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-	if (vkCreatePipelineLayout(this->device, &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
-
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencil.depthTestEnable = VK_TRUE;
@@ -155,8 +240,8 @@ void Application::createGraphicsPipeline() {
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
@@ -171,39 +256,29 @@ void Application::createGraphicsPipeline() {
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
-	if (vkCreateGraphicsPipelines(this->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &this->graphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create graphics pipeline!");
+	/* Libraries keep what the optimized link needs to optimize across them */
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	libraryInfo.flags = libraryFlags;
+	if (libraryFlags != 0) {
+		pipelineInfo.pNext = &libraryInfo;
+		pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
 	}
 
-	/* Clean up the shader modules */
-	vkDestroyShaderModule(this->device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(this->device, vertShaderModule, nullptr);
-}
-
-std::vector<char> Application::readFile(const std::string& filename) {
-	/* Read the file as binary and from the end to get the file size */
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		throw std::runtime_error("failed to open file!");
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
-	/* Use the read position to determine the size of the file and allocate a buffer */
-	size_t fileSize = (size_t) file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-	return buffer;
+	return pipeline;
 }
 
-VkShaderModule Application::createShaderModule(const std::vector<char>& code) {
+VkShaderModule Application::createShaderModule(const std::vector<uint32_t>& code) {
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	/* In bytes */
+	createInfo.codeSize = code.size() * sizeof(uint32_t);
+	createInfo.pCode = code.data();
 
 	VkShaderModule shaderModule;
 	if (vkCreateShaderModule(this->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -212,3 +287,10 @@ VkShaderModule Application::createShaderModule(const std::vector<char>& code) {
 
 	return shaderModule;
 }
+
+/*
+ * Module of the GLSL shader at path, compiled with the given macros or read from the SPIR-V cache if it did not change.
+ */
+VkShaderModule Application::loadShaderModule(const std::string& path, const std::vector<std::string>& defines) {
+	return this->createShaderModule(this->shaderCompiler.load(path, defines));
+}
@@ -0,0 +1,107 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+/*
+ * Host visible buffers written by the CPU every frame, one region per frame in flight:
+ * the draw count and the VkDrawIndexedIndirectCommand of each draw, and the per-draw data they index.
+ */
+void Application::createIndirectDrawBuffers() {
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+	VkDeviceSize storageAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+	this->createBuffer(
+		IndirectDrawList<DrawData>::commandRegionSize(MAX_INDIRECT_DRAWS) * this->framesInFlight,
+		/* Also read by the culling compute shader */
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->indirectCommandBuffer,
+		this->indirectCommandMemory
+	);
+	this->createBuffer(
+		IndirectDrawList<DrawData>::drawDataRegionSize(MAX_INDIRECT_DRAWS, storageAlignment) * this->framesInFlight,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->drawDataBuffer,
+		this->drawDataMemory
+	);
+
+	this->indirectDraws.init(
+		this->indirectCommandBuffer,
+		this->indirectCommandMemory.mapped,
+		this->drawDataBuffer,
+		this->drawDataMemory.mapped,
+		MAX_INDIRECT_DRAWS,
+		this->framesInFlight,
+		storageAlignment
+	);
+}
+
+/*
+ * Write the indirect draws of the frame in sorted order, after waiting for its fence.
+ */
+void Application::writeIndirectDraws() {
+	this->indirectDraws.beginFrame(this->currentFrame);
+	this->drawDataOffset = static_cast<uint32_t>(this->indirectDraws.drawDataOffset());
+
+	const std::vector<SceneObject>& objects = this->scene.getObjects();
+	for (const DrawItem& item : this->renderQueue.getItems()) {
+		if (RenderQueue::keyPipeline(item.key) != PIPELINE_INDIRECT) {
+			continue;
+		}
+
+		const Mesh& mesh = this->scene.getMesh(objects[item.index].mesh);
+		const DrawPushConstants& pushConstants = this->drawPushConstants[item.index];
+
+		DrawData data;
+		data.mvp = pushConstants.mvp;
+		data.colorTextureBlending = pushConstants.colorTextureBlending;
+		uint32_t drawIndex = this->indirectDraws.push(mesh.indexCount, mesh.firstIndex, static_cast<int32_t>(mesh.firstVertex), data);
+
+		/* Bounds tested by the culling compute shader, next to the commands of the frame */
+		if (this->gpuCullingEnabled) {
+			const BoundingSphere& sphere = this->drawBounds[item.index];
+			CullBounds bounds{};
+			bounds.sphere[0] = sphere.center[0];
+			bounds.sphere[1] = sphere.center[1];
+			bounds.sphere[2] = sphere.center[2];
+			bounds.sphere[3] = sphere.radius;
+			bounds.object = item.index;
+			size_t boundsIndex = static_cast<size_t>(this->currentFrame) * MAX_INDIRECT_DRAWS + drawIndex;
+			memcpy(static_cast<char*>(this->cullBoundsMemory.mapped) + boundsIndex * sizeof(CullBounds), &bounds, sizeof(CullBounds));
+		}
+	}
+}
+
+/*
+ * Submit every indirect draw of the frame with as few calls as the device allows:
+ * one vkCmdDrawIndexedIndirectCount reading the count from the buffer, one vkCmdDrawIndexedIndirect with the count,
+ * or one vkCmdDrawIndexedIndirect per draw without multiDrawIndirect.
+ *
+ * With GPU culling the commands come from the output of the culling pass, at the same offsets in the region of the phase.
+ * They are compacted only if the count can be read from the buffer, otherwise the culled ones draw 0 instances.
+ */
+void Application::recordIndirectDraws(VkCommandBuffer commandBuffer, VkDeviceSize culledRegionOffset) {
+	uint32_t drawCount = this->indirectDraws.drawCount();
+	if (drawCount == 0) {
+		return;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->indirectPipelines[this->shadingMode]);
+
+	VkBuffer buffer = this->gpuCullingEnabled ? this->culledCommandBuffer : this->indirectDraws.getCommandBuffer();
+	VkDeviceSize regionOffset = this->gpuCullingEnabled ? culledRegionOffset : 0;
+	VkDeviceSize offset = regionOffset + this->indirectDraws.commandOffset();
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (this->cmdDrawIndexedIndirectCount != nullptr) {
+		/* The GPU reads the number of draws, so it can be written by the GPU too */
+		this->cmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, buffer, regionOffset + this->indirectDraws.countOffset(), this->indirectDraws.getMaxDraws(), stride);
+	} else if (this->multiDrawIndirectSupported) {
+		vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+	} else {
+		for (uint32_t i = 0; i < drawCount; i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + static_cast<VkDeviceSize>(i) * stride, 1, stride);
+		}
+	}
+}
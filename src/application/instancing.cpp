@@ -0,0 +1,99 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+/*
+ * One instance buffer per frame in flight, so the instances of a frame can be rewritten while the GPU reads the other ones.
+ * The buffers are created on the first use and grow with the number of instances.
+ */
+void Application::createInstanceBuffers() {
+	this->instanceBuffers.assign(this->framesInFlight, VK_NULL_HANDLE);
+	this->instanceBufferMemories.resize(this->framesInFlight);
+	this->instanceBufferCapacities.assign(this->framesInFlight, 0);
+}
+
+/*
+ * Copy the instances of the object in the instance buffer of the frame and return how many there are.
+ * Must be called after waiting for the fence of the frame: the GPU is done with its buffer, so it can be rewritten or replaced.
+ */
+uint32_t Application::updateInstanceBuffer(uint32_t frame) {
+	const std::vector<InstanceData>& instances = this->object->getInstances();
+	uint32_t count = static_cast<uint32_t>(instances.size());
+	if (count == 0) {
+		return 0;
+	}
+
+	if (count > this->instanceBufferCapacities[frame]) {
+		this->destroyInstanceBuffer(frame);
+
+		/* Grow to the next power of two to avoid reallocating for every new instance */
+		uint32_t capacity = 1;
+		while (capacity < count) {
+			capacity <<= 1;
+		}
+
+		/* Written by the CPU every frame and read once by the GPU, host visible memory avoids a copy */
+		this->createBuffer(
+			static_cast<VkDeviceSize>(capacity) * sizeof(InstanceData),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			this->instanceBuffers[frame],
+			this->instanceBufferMemories[frame]
+		);
+		this->instanceBufferCapacities[frame] = capacity;
+	}
+
+	memcpy(this->instanceBufferMemories[frame].mapped, instances.data(), static_cast<size_t>(count) * sizeof(InstanceData));
+	return count;
+}
+
+void Application::destroyInstanceBuffer(uint32_t frame) {
+	if (this->instanceBuffers[frame] == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(this->device, this->instanceBuffers[frame], nullptr);
+	this->allocator.free(this->instanceBufferMemories[frame]);
+	this->instanceBuffers[frame] = VK_NULL_HANDLE;
+	this->instanceBufferCapacities[frame] = 0;
+}
+
+/*
+ * Growing the instance buffers leaves holes in the memory blocks, move them out of the sparsest blocks to release those.
+ * The device must be idle: the old buffers are destroyed right away, and the recorded command buffers refer to them
+ * (they are recorded again since the instance buffer is part of their recording state).
+ */
+void Application::defragmentInstanceBuffers() {
+	DefragmentationResult result = this->allocator.defragment([this](const Allocation& source, const Allocation& destination) {
+		/* Only the instance buffers are known to be safe to move, the other allocations stay where they are */
+		for (uint32_t frame = 0; frame < this->instanceBuffers.size(); frame++) {
+			Allocation& memory = this->instanceBufferMemories[frame];
+			if (this->instanceBuffers[frame] == VK_NULL_HANDLE || memory.memory != source.memory || memory.offset != source.offset) {
+				continue;
+			}
+
+			/* Same creation as updateInstanceBuffer, bound to the destination range. Both are host visible, the content is copied on the CPU */
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = static_cast<VkDeviceSize>(this->instanceBufferCapacities[frame]) * sizeof(InstanceData);
+			bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VkBuffer buffer;
+			if (vkCreateBuffer(this->device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+				return false;
+			}
+			vkBindBufferMemory(this->device, buffer, destination.memory, destination.offset);
+			memcpy(destination.mapped, source.mapped, static_cast<size_t>(source.size));
+
+			vkDestroyBuffer(this->device, this->instanceBuffers[frame], nullptr);
+			this->instanceBuffers[frame] = buffer;
+			memory = destination;
+			return true;
+		}
+		return false;
+	});
+
+	if (result.moveCount > 0) {
+		std::cout << "Defragmentation: moved " << result.moveCount << " instance buffers (" << result.bytesMoved << " bytes), freed " << result.blocksFreed << " blocks" << std::endl;
+	}
+}
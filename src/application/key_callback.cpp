@@ -21,6 +21,12 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
 		CASE(GLFW_KEY_Q, key_q)
 		CASE(GLFW_KEY_E, key_e)
 		CASE(GLFW_KEY_T, key_t)
+		CASE(GLFW_KEY_M, key_m)
+		CASE(GLFW_KEY_I, key_i)
+		CASE(GLFW_KEY_C, key_c)
+		CASE(GLFW_KEY_H, key_h)
+		CASE(GLFW_KEY_O, key_o)
+		CASE(GLFW_KEY_P, key_p)
 		default:
 			break;
 	}
@@ -60,37 +66,37 @@ void Application::arrowRight(int key, int scancode, int action, int mods) {
 
 void Application::key_a(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[0] -= 0.1f;
+		this->scene.getObject(this->selectedObject).position[0] -= 0.1f;
 	}
 }
 
 void Application::key_d(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[0] += 0.1f;
+		this->scene.getObject(this->selectedObject).position[0] += 0.1f;
 	}
 }
 
 void Application::key_w(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[1] += 0.1f;
+		this->scene.getObject(this->selectedObject).position[1] += 0.1f;
 	}
 }
 
 void Application::key_s(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[1] -= 0.1f;
+		this->scene.getObject(this->selectedObject).position[1] -= 0.1f;
 	}
 }
 
 void Application::key_q(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[2] += 0.1f;
+		this->scene.getObject(this->selectedObject).position[2] += 0.1f;
 	}
 }
 
 void Application::key_e(int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		this->object->position[2] -= 0.1f;
+		this->scene.getObject(this->selectedObject).position[2] -= 0.1f;
 	}
 }
 
@@ -99,3 +105,49 @@ void Application::key_t(int key, int scancode, int action, int mods) {
 		this->textureEnabled = !this->textureEnabled;
 	}
 }
+
+void Application::key_m(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS) {
+		this->dumpMemoryTelemetry();
+	}
+}
+
+void Application::key_i(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS && this->indirectDrawSupported) {
+		this->indirectDrawEnabled = !this->indirectDrawEnabled;
+	}
+}
+
+void Application::key_c(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS && this->gpuCullingSupported) {
+		this->gpuCullingEnabled = !this->gpuCullingEnabled;
+	}
+}
+
+void Application::key_h(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS && this->occlusionCullingSupported) {
+		this->occlusionCullingEnabled = !this->occlusionCullingEnabled;
+	}
+}
+
+void Application::key_o(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS) {
+		this->cpuOcclusionEnabled = !this->cpuOcclusionEnabled;
+	}
+}
+
+/* Report the pacing of the current present mode, then switch to the next one: the swap chain is recreated after the next present */
+void Application::key_p(int key, int scancode, int action, int mods) {
+	if (action == GLFW_PRESS) {
+		this->logFramePacing();
+
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < PRESENT_MODE_COUNT; i++) {
+			if (PRESENT_MODES[i] == this->presentMode) {
+				next = (i + 1) % PRESENT_MODE_COUNT;
+			}
+		}
+		this->presentMode = PRESENT_MODES[next];
+		this->framebufferResized = true;
+	}
+}
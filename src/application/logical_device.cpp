@@ -8,6 +8,9 @@ void Application::createLogicalDevice() {
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	/* Use a set to avoid duplicate queue families when one queue family supports multiple operations */
 	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+	if (indices.transferFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -20,8 +23,16 @@ void Application::createLogicalDevice() {
 	}
 
 	/* Specify which device features to enable */
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(this->physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	/* Optional features of the indirect draw path */
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	this->indirectDrawSupported = supportedFeatures.drawIndirectFirstInstance;
+	this->multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect;
 
 	/* Set up information about the logical device */
 	VkDeviceCreateInfo createInfo{};
@@ -29,8 +40,29 @@ void Application::createLogicalDevice() {
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t> (queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+	/* Optional extensions are enabled only if the device supports them */
+	std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+	this->memoryBudgetSupported = this->isMemoryBudgetSupported();
+	if (this->memoryBudgetSupported) {
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	bool drawIndirectCountSupported = this->isDeviceExtensionSupported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (drawIndirectCountSupported) {
+		enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+	/* The graphics pipelines are linked from libraries when the device can */
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+	this->pipelineLibrarySupported = this->isPipelineLibrarySupported();
+	if (this->pipelineLibrarySupported) {
+		enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		createInfo.pNext = &pipelineLibraryFeatures;
+	}
+
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
 
 	/* Validation layers in logical devices are deprecated, but we set them up for backwards compatibility */
 	if (enableValidationLayers) {
@@ -48,4 +80,78 @@ void Application::createLogicalDevice() {
 	/* Get the queues handles */
 	vkGetDeviceQueue(this->device, indices.graphicsFamily.value(), 0, &this->graphicsQueue);
 	vkGetDeviceQueue(this->device, indices.presentFamily.value(), 0, &this->presentQueue);
-}
\ No newline at end of file
+	if (indices.transferFamily.has_value()) {
+		vkGetDeviceQueue(this->device, indices.transferFamily.value(), 0, &this->transferQueue);
+	}
+
+	/* Extension commands are not exported by the loader, like vkCreateDebugUtilsMessengerEXT */
+	if (drawIndirectCountSupported) {
+		this->cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR) vkGetDeviceProcAddr(this->device, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+	this->indirectDrawEnabled = this->indirectDrawSupported;
+}
+
+/*
+ * VK_EXT_memory_budget is queried with vkGetPhysicalDeviceMemoryProperties2, which needs a Vulkan 1.1 device.
+ */
+bool Application::isMemoryBudgetSupported() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_1) {
+		return false;
+	}
+
+	return this->isDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+/*
+ * VK_EXT_graphics_pipeline_library needs VK_KHR_pipeline_library, and its feature is queried with vkGetPhysicalDeviceFeatures2 (Vulkan 1.1).
+ */
+bool Application::isPipelineLibrarySupported() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_1
+		|| !this->isDeviceExtensionSupported(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+		|| !this->isDeviceExtensionSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &pipelineLibraryFeatures;
+	vkGetPhysicalDeviceFeatures2(this->physicalDevice, &features);
+	if (pipelineLibraryFeatures.graphicsPipelineLibrary != VK_TRUE) {
+		return false;
+	}
+
+	/* Every variant is linked at creation on the main thread, without fast linking it can take as long as a full compilation */
+	VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties{};
+	pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &pipelineLibraryProperties;
+	vkGetPhysicalDeviceProperties2(this->physicalDevice, &properties2);
+
+	if (pipelineLibraryProperties.graphicsPipelineLibraryFastLinking != VK_TRUE) {
+		std::cout << "Graphics pipeline libraries cannot be fast-linked, the variants are compiled in the background instead" << std::endl;
+		return false;
+	}
+	std::cout << "Graphics pipeline libraries with fast linking, the variants are linked from them" << std::endl;
+	return true;
+}
+
+bool Application::isDeviceExtensionSupported(const char* extensionName) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(this->physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(this->physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions) {
+		if (strcmp(extension.extensionName, extensionName) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,163 @@
+#include "application.hpp"
+#include "vertex.hpp"
+
+#include <thread>
+#include <future>
+
+/*
+ * One command pool per frame in flight and recording chunk: a pool can only be used by one thread at a time,
+ * and each chunk of the draws of a frame is recorded by a single thread.
+ */
+void Application::createSecondaryCommandPools() {
+	/* The thread recording the primary command buffer records a chunk too */
+	this->recordingChunkCount = std::max(1u, std::thread::hardware_concurrency());
+
+	QueueFamilyIndices queueFamilyIndices = this->findQueueFamilies(this->physicalDevice);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	/* The secondary command buffers are recorded again one by one, with their primary */
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+	this->secondaryCommandPools.resize(this->framesInFlight * this->recordingChunkCount);
+	for (VkCommandPool& pool : this->secondaryCommandPools) {
+		if (vkCreateCommandPool(this->device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create secondary command pool!");
+		}
+	}
+}
+
+void Application::destroySecondaryCommandPools() {
+	for (VkCommandPool pool : this->secondaryCommandPools) {
+		vkDestroyCommandPool(this->device, pool, nullptr);
+	}
+	this->secondaryCommandPools.clear();
+}
+
+/*
+ * One secondary command buffer per chunk for each primary command buffer, so that recording the primary of an image
+ * does not invalidate the cached primary of another image. They come from the pool of their frame and chunk.
+ */
+void Application::allocateSecondaryCommandBuffers() {
+	size_t imageCount = this->swapChainImages.size();
+	this->secondaryCommandBuffers.resize(this->framesInFlight * imageCount * this->recordingChunkCount);
+
+	std::vector<VkCommandBuffer> poolBuffers(imageCount);
+	for (uint32_t frame = 0; frame < this->framesInFlight; frame++) {
+		for (uint32_t chunk = 0; chunk < this->recordingChunkCount; chunk++) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = this->secondaryCommandPools[frame * this->recordingChunkCount + chunk];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = static_cast<uint32_t>(imageCount);
+
+			if (vkAllocateCommandBuffers(this->device, &allocInfo, poolBuffers.data()) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffers!");
+			}
+			for (size_t image = 0; image < imageCount; image++) {
+				this->secondaryCommandBuffers[this->secondaryCommandBufferIndex(frame, static_cast<uint32_t>(image), chunk)] = poolBuffers[image];
+			}
+		}
+	}
+}
+
+/*
+ * Free secondary command buffers allocated for imageCount swap chain images, which may not be the current count
+ * when they were retired with a previous swap chain.
+ */
+void Application::freeSecondaryCommandBuffers(const std::vector<VkCommandBuffer>& commandBuffers, size_t imageCount) {
+	std::vector<VkCommandBuffer> poolBuffers(imageCount);
+	for (uint32_t frame = 0; frame < this->framesInFlight; frame++) {
+		for (uint32_t chunk = 0; chunk < this->recordingChunkCount; chunk++) {
+			for (size_t image = 0; image < imageCount; image++) {
+				poolBuffers[image] = commandBuffers[(frame * imageCount + image) * this->recordingChunkCount + chunk];
+			}
+			vkFreeCommandBuffers(this->device, this->secondaryCommandPools[frame * this->recordingChunkCount + chunk], static_cast<uint32_t>(imageCount), poolBuffers.data());
+		}
+	}
+}
+
+size_t Application::secondaryCommandBufferIndex(uint32_t frame, uint32_t imageIndex, uint32_t chunk) {
+	return (static_cast<size_t>(frame) * this->swapChainImages.size() + imageIndex) * this->recordingChunkCount + chunk;
+}
+
+/*
+ * Split the direct draws of the render queue in chunkCount ranges recorded at the same time in secondary command buffers,
+ * then execute them from the primary one, inside the render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+ * The indirect draws, submitted by a single call, go to the last chunk.
+ */
+void Application::recordDrawsInParallel(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, size_t directDrawCount, uint32_t chunkCount) {
+	if (this->recordingPool == nullptr) {
+		this->recordingPool = std::make_unique<ThreadPool>(this->recordingChunkCount - 1);
+	}
+
+	const std::vector<DrawItem>& items = this->renderQueue.getItems();
+	size_t chunkSize = (directDrawCount + chunkCount - 1) / chunkCount;
+	auto chunkBegin = [&](uint32_t chunk) {
+		return items.data() + std::min(chunk * chunkSize, directDrawCount);
+	};
+	auto chunkEnd = [&](uint32_t chunk) {
+		return chunk + 1 == chunkCount ? items.data() + items.size() : chunkBegin(chunk + 1);
+	};
+	/* The chunks of a primary command buffer follow each other */
+	VkCommandBuffer* secondaries = &this->secondaryCommandBuffers[this->secondaryCommandBufferIndex(this->currentFrame, imageIndex, 0)];
+
+	/* The first chunk is recorded by this thread while the workers record the others */
+	std::vector<std::future<void>> chunks;
+	for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+		VkCommandBuffer secondary = secondaries[chunk];
+		const DrawItem* begin = chunkBegin(chunk);
+		const DrawItem* end = chunkEnd(chunk);
+		chunks.push_back(this->recordingPool->submit([this, secondary, pass, imageIndex, begin, end] {
+			this->recordSecondaryCommandBuffer(secondary, pass, imageIndex, begin, end);
+		}));
+	}
+	/* Every chunk reads the render queue and records from a pool of the frame, they must all be done before an exception leaves this function */
+	try {
+		this->recordSecondaryCommandBuffer(secondaries[0], pass, imageIndex, chunkBegin(0), chunkEnd(0));
+	} catch (...) {
+		for (std::future<void>& chunk : chunks) {
+			chunk.wait();
+		}
+		throw;
+	}
+
+	for (std::future<void>& chunk : chunks) {
+		chunk.wait();
+	}
+	for (std::future<void>& chunk : chunks) {
+		chunk.get();
+	}
+
+	vkCmdExecuteCommands(commandBuffer, chunkCount, secondaries);
+}
+
+/*
+ * Record the draws [begin, end) in a secondary command buffer continuing the render pass.
+ * Only the render pass is inherited from the primary command buffer, the states shared by the draws are set again.
+ */
+void Application::recordSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkRenderPass pass, uint32_t imageIndex, const DrawItem* begin, const DrawItem* end) {
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = pass;
+	inheritanceInfo.subpass = 0;
+	/* Optional, but lets the driver know the attachments */
+	inheritanceInfo.framebuffer = this->swapChainFramebuffers[imageIndex];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording secondary command buffer!");
+	}
+
+	this->bindSceneState(commandBuffer);
+	this->recordDraws(commandBuffer, begin, end);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
@@ -98,5 +98,16 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device) {
 		i++;
 	}
 
+	/* Look for a transfer family without graphics support, preferring one without compute support too (the DMA engines) */
+	for (uint32_t j = 0; j < queueFamilyCount; j++) {
+		VkQueueFlags flags = queueFamilies[j].queueFlags;
+		if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+			continue;
+		}
+		if (!indices.transferFamily.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+			indices.transferFamily = j;
+		}
+	}
+
 	return indices;
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "application.hpp"
+
+#include <filesystem>
+#include <iomanip>
+
+/* Size of the header every pipeline cache data starts with (VkPipelineCacheHeaderVersionOne) */
+static const size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+/*
+ * Create the pipeline cache from the data saved by the last run, so the driver does not compile the shaders again.
+ * The data is only given to the driver if it was written by the same driver for the same device, otherwise the cache starts empty.
+ */
+void Application::createPipelineCache() {
+	std::vector<char> data;
+	std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+	if (file.is_open()) {
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file) {
+			data.clear();
+		}
+	}
+
+	if (!data.empty() && !this->isPipelineCacheDataValid(data)) {
+		std::cout << "Pipeline cache " << PIPELINE_CACHE_PATH << " was written by another driver or device, starting empty" << std::endl;
+		data.clear();
+	}
+	this->pipelineCacheLoadedSize = data.size();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(this->device, &cacheInfo, nullptr, &this->pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+/*
+ * The header holds its size, its version, the vendor and device IDs and the pipeline cache UUID of the driver which wrote it.
+ */
+bool Application::isPipelineCacheDataValid(const std::vector<char>& data) {
+	if (data.size() < PIPELINE_CACHE_HEADER_SIZE) {
+		return false;
+	}
+
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+	uint8_t uuid[VK_UUID_SIZE];
+	memcpy(uuid, data.data() + sizeof(header), VK_UUID_SIZE);
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+
+	return header[0] >= PIPELINE_CACHE_HEADER_SIZE
+		&& header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header[2] == properties.vendorID
+		&& header[3] == properties.deviceID
+		&& memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+/*
+ * Write the cache for the next run, in a temporary file renamed over the previous one:
+ * a crash while writing leaves the previous cache, never a truncated one.
+ */
+void Application::savePipelineCache() {
+	size_t size = 0;
+	if (vkGetPipelineCacheData(this->device, this->pipelineCache, &size, nullptr) != VK_SUCCESS) {
+		throw std::runtime_error("failed to get pipeline cache size!");
+	}
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(this->device, this->pipelineCache, &size, data.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to get pipeline cache data!");
+	}
+
+	std::string temporaryPath = PIPELINE_CACHE_PATH + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), static_cast<std::streamsize>(size));
+		if (!file) {
+			std::cerr << "Failed to write pipeline cache " << temporaryPath << std::endl;
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, PIPELINE_CACHE_PATH, error);
+	if (error) {
+		std::cerr << "Failed to replace pipeline cache " << PIPELINE_CACHE_PATH << ": " << error.message() << std::endl;
+		return;
+	}
+	std::cout << "Pipeline cache written to " << PIPELINE_CACHE_PATH << " (" << size << " bytes)" << std::endl;
+}
+
+void Application::destroyPipelineCache() {
+	this->savePipelineCache();
+	vkDestroyPipelineCache(this->device, this->pipelineCache, nullptr);
+}
+
+/*
+ * Log the time the driver took to create a pipeline, started at start, and add it to the total of the run.
+ */
+void Application::logPipelineCreation(const std::string& name, std::chrono::high_resolution_clock::time_point start) {
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	this->pipelineCreationMilliseconds += milliseconds;
+	std::cout << "Pipeline " << name << " created in " << std::fixed << std::setprecision(3) << milliseconds << " ms" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+/*
+ * Total of the pipelines created at startup, to compare a cold start (empty cache) with a warm one.
+ */
+void Application::logPipelineCreationTotal() {
+	std::cout << "Pipelines created in " << std::fixed << std::setprecision(3) << this->pipelineCreationMilliseconds << " ms ("
+		<< (this->pipelineCacheLoadedSize > 0 ? "warm" : "cold") << " pipeline cache, " << this->pipelineCacheLoadedSize << " bytes loaded)" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
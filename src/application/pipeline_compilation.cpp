@@ -0,0 +1,105 @@
+#include "application.hpp"
+
+#include <iomanip>
+
+/*
+ * Create the shadingMode variant of a pipeline on a worker thread, variants[shadingMode] stays null until it is polled.
+ * The worker compiles its own shader modules (read from the SPIR-V cache) and only reads the objects the pipelines are created with,
+ * which live as long as the device. The pipeline cache is internally synchronized, the workers share it with the main thread.
+ */
+void Application::compilePipelineAsync(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, uint32_t shadingMode, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+	if (this->pipelineCompilePool == nullptr) {
+		this->pipelineCompilePool = std::make_unique<ThreadPool>();
+	}
+	variants[shadingMode] = VK_NULL_HANDLE;
+
+	PendingPipeline pending;
+	pending.variants = &variants;
+	pending.shadingMode = shadingMode;
+	pending.name = vertPath + " + " + fragPath + " (" + SHADING_MODE_NAMES[shadingMode] + ")";
+	pending.result = this->pipelineCompilePool->submit([this, shadingMode, vertPath, fragPath, bindingDescriptions, attributeDescriptions] {
+		auto start = std::chrono::high_resolution_clock::now();
+		VkShaderModule vertShaderModule = this->loadShaderModule(vertPath);
+		VkShaderModule fragShaderModule = this->loadShaderModule(fragPath);
+
+		VkPipeline pipeline = this->createPipeline(vertShaderModule, fragShaderModule, shadingMode, bindingDescriptions, attributeDescriptions);
+
+		vkDestroyShaderModule(this->device, fragShaderModule, nullptr);
+		vkDestroyShaderModule(this->device, vertShaderModule, nullptr);
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return std::make_pair(pipeline, milliseconds);
+	});
+	this->pendingPipelines.push_back(std::move(pending));
+}
+
+/*
+ * Link the shadingMode variant again with link time optimization on a worker thread, to replace its fast link once polled.
+ */
+void Application::linkPipelineAsync(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, uint32_t shadingMode, const PipelineLibraries& libraries, const std::string& name) {
+	if (this->pipelineCompilePool == nullptr) {
+		this->pipelineCompilePool = std::make_unique<ThreadPool>();
+	}
+
+	PendingPipeline pending;
+	pending.variants = &variants;
+	pending.shadingMode = shadingMode;
+	pending.name = name;
+	pending.result = this->pipelineCompilePool->submit([this, shadingMode, libraries] {
+		auto start = std::chrono::high_resolution_clock::now();
+		VkPipeline pipeline = this->linkPipeline(libraries, shadingMode, true);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return std::make_pair(pipeline, milliseconds);
+	});
+	this->pendingPipelines.push_back(std::move(pending));
+}
+
+/*
+ * Make the pipelines the workers are done with available to the next recordings, without waiting for the others.
+ * Rethrows the error of a pipeline which failed to compile.
+ */
+void Application::pollPipelineCompilations() {
+	for (size_t i = 0; i < this->pendingPipelines.size();) {
+		PendingPipeline& pending = this->pendingPipelines[i];
+		if (pending.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			i++;
+			continue;
+		}
+
+		std::pair<VkPipeline, double> result = pending.result.get();
+		VkPipeline& variant = (*pending.variants)[pending.shadingMode];
+		/* A fast-linked pipeline replaced by its optimized link, its handle may be reused once destroyed so the cached recordings are dropped */
+		if (variant != VK_NULL_HANDLE) {
+			/* The frames in flight may still use it */
+			VkPipeline retired = variant;
+			this->deletionQueue.push(this->submittedFrameCount, [this, retired] {
+				vkDestroyPipeline(this->device, retired, nullptr);
+			});
+			this->commandBufferCache.invalidate();
+		}
+		variant = result.first;
+		std::cout << "Pipeline " << pending.name << " compiled in the background in " << std::fixed << std::setprecision(3) << result.second << " ms" << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+
+		this->pendingPipelines.erase(this->pendingPipelines.begin() + i);
+	}
+}
+
+/*
+ * Wait for every worker, before the pipelines, their layout and the pipeline cache are destroyed.
+ */
+void Application::waitPipelineCompilations() {
+	for (PendingPipeline& pending : this->pendingPipelines) {
+		pending.result.wait();
+	}
+	this->pollPipelineCompilations();
+}
+
+/*
+ * Whether every pipeline has its shadingMode variant, a frame can only use a variant if all of its draws can.
+ */
+bool Application::isShadingModeReady(uint32_t shadingMode) {
+	return this->graphicsPipelines[shadingMode] != VK_NULL_HANDLE
+		&& this->instancedPipelines[shadingMode] != VK_NULL_HANDLE
+		&& this->indirectPipelines[shadingMode] != VK_NULL_HANDLE;
+}
@@ -0,0 +1,87 @@
+#include "application.hpp"
+
+/*
+ * Compile the four parts of a pipeline as libraries (VK_EXT_graphics_pipeline_library), then link every variant from them.
+ * The shaders are only compiled here: a fast link reuses their code as it is and takes microseconds, so all the variants are
+ * available for the first frame. Each one is then linked again with link time optimization by a worker, and replaced once done.
+ */
+void Application::createPipelineVariantsFromLibraries(std::array<VkPipeline, SHADING_MODE_COUNT>& variants, const std::string& vertPath, const std::string& fragPath, const std::vector<VkVertexInputBindingDescription>& bindingDescriptions, const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+	std::string name = vertPath + " + " + fragPath;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (this->fragmentOutputLibrary == VK_NULL_HANDLE) {
+		this->fragmentOutputLibrary = this->createPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE, SHADING_BLENDED, {}, {}, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+	}
+
+	VkShaderModule vertShaderModule = this->loadShaderModule(vertPath);
+	VkShaderModule fragShaderModule = this->loadShaderModule(fragPath);
+
+	PipelineLibraries libraries{};
+	libraries.vertexInput = this->createPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE, SHADING_BLENDED, bindingDescriptions, attributeDescriptions, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+	libraries.preRasterization = this->createPipeline(vertShaderModule, VK_NULL_HANDLE, SHADING_BLENDED, {}, {}, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+	for (uint32_t shadingMode = 0; shadingMode < SHADING_MODE_COUNT; shadingMode++) {
+		libraries.fragmentShaders[shadingMode] = this->createPipeline(VK_NULL_HANDLE, fragShaderModule, shadingMode, {}, {}, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+	}
+
+	/* The libraries do not need the modules anymore */
+	vkDestroyShaderModule(this->device, fragShaderModule, nullptr);
+	vkDestroyShaderModule(this->device, vertShaderModule, nullptr);
+	this->logPipelineCreation(name + " (libraries)", start);
+
+	for (uint32_t shadingMode = 0; shadingMode < SHADING_MODE_COUNT; shadingMode++) {
+		std::string variantName = name + " (" + SHADING_MODE_NAMES[shadingMode] + ")";
+
+		start = std::chrono::high_resolution_clock::now();
+		variants[shadingMode] = this->linkPipeline(libraries, shadingMode, false);
+		this->logPipelineCreation(variantName + " fast link", start);
+
+		this->linkPipelineAsync(variants, shadingMode, libraries, variantName + " optimized link");
+	}
+
+	this->pipelineLibraries.push_back(libraries);
+}
+
+/*
+ * Link a complete pipeline from the libraries, the fragment shader being the one of shadingMode.
+ * Without optimize the driver only combines the compiled parts, with it the libraries are compiled again as a whole.
+ */
+VkPipeline Application::linkPipeline(const PipelineLibraries& libraries, uint32_t shadingMode, bool optimize) {
+	VkPipeline parts[] = {
+		libraries.vertexInput,
+		libraries.preRasterization,
+		libraries.fragmentShaders[shadingMode],
+		this->fragmentOutputLibrary
+	};
+
+	VkPipelineLibraryCreateInfoKHR libraryInfo{};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	libraryInfo.libraryCount = static_cast<uint32_t>(std::size(parts));
+	libraryInfo.pLibraries = parts;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &libraryInfo;
+	pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+	pipelineInfo.layout = this->pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to link graphics pipeline!");
+	}
+	return pipeline;
+}
+
+void Application::destroyPipelineLibraries() {
+	for (const PipelineLibraries& libraries : this->pipelineLibraries) {
+		vkDestroyPipeline(this->device, libraries.vertexInput, nullptr);
+		vkDestroyPipeline(this->device, libraries.preRasterization, nullptr);
+		for (VkPipeline fragmentShader : libraries.fragmentShaders) {
+			vkDestroyPipeline(this->device, fragmentShader, nullptr);
+		}
+	}
+	this->pipelineLibraries.clear();
+	vkDestroyPipeline(this->device, this->fragmentOutputLibrary, nullptr);
+	this->fragmentOutputLibrary = VK_NULL_HANDLE;
+}
@@ -1,18 +1,43 @@
 #include "application.hpp"
 
 void Application::createRenderPass() {
+	/* Clear both attachments and present the color */
+	this->renderPass = this->createRenderPass(
+		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_ATTACHMENT_STORE_OP_DONT_CARE
+	);
+
+	/* The occlusion culling splits the frame in two passes, with the depth pyramid built from the depth in between */
+	this->earlyRenderPass = this->createRenderPass(
+		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_ATTACHMENT_STORE_OP_STORE
+	);
+	this->lateRenderPass = this->createRenderPass(
+		VK_ATTACHMENT_LOAD_OP_LOAD,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ATTACHMENT_STORE_OP_DONT_CARE
+	);
+}
+
+/*
+ * Only the load and store operations and the layouts differ between the render passes, so they stay compatible:
+ * the framebuffers and the pipelines work with all of them.
+ */
+VkRenderPass Application::createRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout colorInitialLayout, VkImageLayout colorFinalLayout, VkImageLayout depthInitialLayout, VkAttachmentStoreOp depthStoreOp) {
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = this->swapChainImageFormat;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	/* Specify what to do with the data in the attachment before rendering and after rendering: clear then store */
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	/* Specify what to do with the data in the attachment before rendering and after rendering: clear (or load) then store */
+	colorAttachment.loadOp = loadOp;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	/* Stencil buffer is not used, so we don't care about loading and storing */
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	/* Specify the layout the image will have before the render pass begins and after it ends */
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.initialLayout = colorInitialLayout;
+	colorAttachment.finalLayout = colorFinalLayout;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
@@ -22,11 +47,11 @@ void Application::createRenderPass() {
 	VkAttachmentDescription depthAttachment{};
 	depthAttachment.format = this->findDepthFormat();
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.loadOp = loadOp;
+	depthAttachment.storeOp = depthStoreOp;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.initialLayout = depthInitialLayout;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference depthAttachmentRef{};
@@ -47,6 +72,11 @@ void Application::createRenderPass() {
 	dependency.srcAccessMask = 0;
 	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	/* The color written by the previous pass is loaded (the depth is synchronized by the depth pyramid barriers) */
+	if (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	}
 
 	std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
 	VkRenderPassCreateInfo renderPassInfo{};
@@ -58,7 +88,9 @@ void Application::createRenderPass() {
 	renderPassInfo.dependencyCount = 1;
 	renderPassInfo.pDependencies = &dependency;
 
-	if (vkCreateRenderPass(this->device, &renderPassInfo, nullptr, &this->renderPass) != VK_SUCCESS) {
+	VkRenderPass pass;
+	if (vkCreateRenderPass(this->device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create render pass!");
 	}
+	return pass;
 }
\ No newline at end of file
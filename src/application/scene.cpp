@@ -0,0 +1,35 @@
+#include "application.hpp"
+
+/*
+ * The loaded model, textured and spinning around its baricenter.
+ * Its mesh and material can be shared by any number of scene objects.
+ */
+void Application::createScene() {
+	this->occlusionRasterizer.resize(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+
+	/* Sphere around the baricenter holding every vertex */
+	BoundingSphere bounds;
+	bounds.center = this->object->getBaricenter();
+	for (const Vertex& vertex : this->object->getVertices()) {
+		ft::vec3 offset = vertex.pos - bounds.center;
+		bounds.radius = std::max(bounds.radius, offset.lengthSquared());
+	}
+	bounds.radius = std::sqrt(bounds.radius);
+
+	uint32_t mesh = this->scene.addMesh(this->uploadMesh(*this->object), bounds);
+
+	Material textured;
+	textured.textureIndex = 0;
+	uint32_t material = this->scene.addMaterial(textured);
+
+	SceneObject model;
+	model.mesh = mesh;
+	model.material = material;
+	model.position = this->object->position;
+	model.pivot = this->object->getBaricenter();
+	model.spinSpeed = ft::radians(90.0f);
+	/* The instances of the loaded model, if any, are drawn at its place */
+	model.instanced = true;
+
+	this->selectedObject = this->scene.addObject(model);
+}
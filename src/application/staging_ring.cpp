@@ -0,0 +1,19 @@
+#include "application.hpp"
+
+/*
+ * Uploads (vertices, indices, textures) take their source memory from a single persistently mapped staging buffer used as a ring,
+ * instead of creating, mapping and freeing a temporary staging buffer each time.
+ */
+void Application::createStagingRing() {
+	this->createBuffer(
+		STAGING_RING_SIZE,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->stagingRingBuffer, this->stagingRingMemory
+	);
+
+	/* A span is read by the batch of uploads of the same serial, so when the ring is full we wait for that batch */
+	this->stagingRing.init(this->stagingRingBuffer, this->stagingRingMemory.mapped, STAGING_RING_SIZE, [this](uint64_t serial) {
+		this->uploadContext.wait(serial);
+	});
+}
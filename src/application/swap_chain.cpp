@@ -1,11 +1,10 @@
 #include "application.hpp"
 
+/*
+ * The new swap chain is created while the frames in flight still render to and present the images of the old one:
+ * it is given as oldSwapchain, and everything created with it is retired to the deletion queue instead of waiting for the device.
+ */
 void Application::recreateSwapChain() {
-	/* TODO: Instead of waiting for the device to become idle, which force us to stop rendering,
-			we should recreate the swap chain while we are still rendering to the images of the old swap chain.
-			For that we need to pass the previous swap chain to the oldSwapChain field in the VkSwapchainCreateInfoKHR
-			struct and destroy the old swap chain as soon as we are done with it */
-	
 	/* If the window is minimized, wait until it is restored */
 	int width = 0, height = 0;
 	glfwGetFramebufferSize(window, &width, &height);
@@ -14,14 +13,19 @@ void Application::recreateSwapChain() {
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(this->device);
-
 	this->cleanupSwapChain();
+	/* They refer to the old framebuffers and may still be pending, retired before the image count changes */
+	this->destroyCommandBuffers();
 
 	this->createSwapChain();
 	this->createImageViews();
 	this->createDepthResources();
+	if (this->occlusionCullingSupported) {
+		this->createDepthPyramidImage();
+	}
 	this->createFramebuffers();
+
+	this->createCommandBuffers();
 }
 
 void Application::createSwapChain() {
@@ -34,6 +38,7 @@ void Application::createSwapChain() {
 	/* Store the chosen values for later use */
 	this->swapChainImageFormat = surfaceFormat.format;
 	this->swapChainExtent = extent;
+	this->swapChainPresentMode = presentMode;
 
 	/* Choose the number of images in the swap chain. We try to get one more than the minimum to avoid waiting for the driver to complete internal operations before we can acquire another image to render to */
 	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -78,8 +83,9 @@ void Application::createSwapChain() {
 	createInfo.presentMode = presentMode;
 	/* Specify if we care about the color of pixels that are obscured, e.g. because another window is in front of them. If true, the implementation may discard rendering operations that are obscured */
 	createInfo.clipped = VK_TRUE;
-	/* Specify a handle to an old swap chain if we are recreating it (when the window is resized for example) */
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	/* Specify a handle to an old swap chain if we are recreating it (when the window is resized for example).
+		It is retired: its acquired images can still be presented, and it is destroyed by the deletion queue */
+	createInfo.oldSwapchain = this->swapChain;
 
 	/* Create the swap chain */
 	if (vkCreateSwapchainKHR(this->device, &createInfo, nullptr, &this->swapChain) != VK_SUCCESS) {
@@ -90,6 +96,8 @@ void Application::createSwapChain() {
 	vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, nullptr);
 	this->swapChainImages.resize(imageCount);
 	vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, this->swapChainImages.data());
+
+	std::cout << "Swap chain: " << imageCount << " images, present mode " << getPresentModeName(presentMode) << ", " << this->framesInFlight << " frames in flight" << std::endl;
 }
 
 SwapChainSupportDetails Application::querySwapChainSupport(VkPhysicalDevice device) {
@@ -146,14 +154,15 @@ VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const std::vector<VkSurf
  * VK_PRESENT_MODE_MAILBOX_KHR
  */
 VkPresentModeKHR Application::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-	/* Check for the preferred presentation mode: Mailbox (triple buffering) */
+	/* Check for the requested presentation mode, Mailbox (triple buffering) unless --present-mode says otherwise */
 	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		if (availablePresentMode == this->presentMode) {
 			return availablePresentMode;
 		}
 	}
 
-	/* If the preferred presentation mode is not available, return the default one */
+	/* If the requested presentation mode is not available, return the one every surface supports */
+	std::cout << "Present mode " << getPresentModeName(this->presentMode) << " is not supported, using fifo" << std::endl;
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -1,9 +1,11 @@
 #include "application.hpp"
 
 void Application::createSyncObjects() {
-	this->imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    this->renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    this->inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	this->imageAvailableSemaphores.resize(this->framesInFlight);
+    this->renderFinishedSemaphores.resize(this->framesInFlight);
+    this->inFlightFences.resize(this->framesInFlight);
+    /* No frame was submitted in them yet */
+    this->frameStartTimes.assign(this->framesInFlight, std::chrono::high_resolution_clock::time_point{});
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -12,7 +14,7 @@ void Application::createSyncObjects() {
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < this->framesInFlight; i++) {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &this->imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(device, &semaphoreInfo, nullptr, &this->renderFinishedSemaphores[i]) != VK_SUCCESS ||
             vkCreateFence(device, &fenceInfo, nullptr, &this->inFlightFences[i]) != VK_SUCCESS) {
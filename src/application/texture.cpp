@@ -3,36 +3,22 @@
 
 /* Step by step:
  * 0. Read the image data from a file
- * 1. Create a staging buffer
- * 2. Copy the pixel data to the staging buffer
- * 3. Create an image object
- * 4. Transition the image object to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
- * 5. Copy the staging buffer to the image object
- * 6. Transition the image object to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+ * 1. Create an image object
+ * 2. Copy the pixel data to a region of the staging ring and queue the upload request (one per band of rows for large textures)
+ * 3. Transition the image object to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+ * 4. Copy the staging region to the image object
+ * 5. Transition the image object to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, handing it over to the graphics queue
+ * Steps 3 to 5 are recorded by the next flushUploads(). Step 2 is thread safe, so steps 0 to 2 could run on a worker.
  */
 void Application::createTextureImage() {
 	int texWidth, texHeight, texChannels;
 	ImageLoader imageLoader;
 	uint8_t* pixels = imageLoader.loadImage(this->texture_path, &texWidth, &texHeight);
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 	if (!pixels) {
 		throw std::runtime_error("failed to load texture image!");
 	}
 
-	/* Create a staging buffer to copy the pixel data to */
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	/* Copy the pixel data to the staging buffer */
-	void* data;
-	vkMapMemory(this->device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(this->device, stagingBufferMemory);
-
-	imageLoader.freeImage(pixels);
-
 	this->createImage(
 		texWidth, texHeight,
 		VK_FORMAT_R8G8B8A8_SRGB,
@@ -42,12 +28,33 @@ void Application::createTextureImage() {
 		this->textureImage, this->textureImageMemory
 	);
 
-	this->transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	this->copyBufferToImage(stagingBuffer, this->textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	this->transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkImage image = this->textureImage;
+	uint32_t width = static_cast<uint32_t>(texWidth);
+	uint32_t height = static_cast<uint32_t>(texHeight);
+
+	/* A texture larger than the staging ring is copied in bands of rows, each one a request of its own.
+		The first band starts the transition to TRANSFER_DST and the last one ends it, the requests are recorded in order.
+		When the ring is full of bands, enqueue() submits them and waits for the GPU before taking the next one */
+	VkDeviceSize rowSize = static_cast<VkDeviceSize>(width) * 4;
+	uint32_t bandRows = static_cast<uint32_t>(std::max<VkDeviceSize>(1, STAGING_TEXTURE_BAND_SIZE / rowSize));
+	for (uint32_t firstRow = 0; firstRow < height; firstRow += bandRows) {
+		uint32_t rows = std::min(bandRows, height - firstRow);
+		bool firstBand = firstRow == 0;
+		bool lastBand = firstRow + rows == height;
+
+		/* The offset of a buffer to image copy must be a multiple of 4 */
+		this->uploadContext.enqueue(pixels + firstRow * rowSize, rows * rowSize, 4, [this, image, width, rows, firstRow, firstBand, lastBand](const StagingRegion& staging) {
+			if (firstBand) {
+				this->transitionImageLayout(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+			}
+			this->copyBufferToImage(staging.buffer, staging.offset, image, width, rows, firstRow);
+			if (lastBand) {
+				this->transitionImageLayout(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			}
+		});
+	}
 
-	vkDestroyBuffer(this->device, stagingBuffer, nullptr);
-	vkFreeMemory(this->device, stagingBufferMemory, nullptr);
+	imageLoader.freeImage(pixels);
 }
 
 void Application::createTextureSampler() {
@@ -84,8 +91,12 @@ void Application::createTextureImageView() {
 	this->textureImageView = this->createImageView(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
+/*
+ * The barrier is only recorded in the current batch of uploads, it is executed at the next flushUploads().
+ * The transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL also releases the image from the transfer queue to the graphics queue.
+ */
 void Application::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+	VkCommandBuffer commandBuffer = this->uploadContext.commandBuffer();
 
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -117,6 +128,10 @@ void Application::transitionImageLayout(VkImage image, VkFormat format, VkImageL
 
 		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		/* The fragment shader stage is not available on a transfer queue, the upload context splits the barrier in release and acquire */
+		this->uploadContext.releaseImage(barrier, sourceStage, destinationStage);
+		return;
 	} else {
 		throw std::invalid_argument("unsupported layout transition!");
 	}
@@ -129,15 +144,16 @@ void Application::transitionImageLayout(VkImage image, VkFormat format, VkImageL
 		0, nullptr,
 		1, &barrier
 	);
-
-	endSingleTimeCommands(commandBuffer);
 }
 
-void Application::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+/*
+ * Copy height rows of width pixels to the image, starting at its row firstRow.
+ */
+void Application::copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t firstRow) {
+	VkCommandBuffer commandBuffer = this->uploadContext.commandBuffer();
 
 	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
+	region.bufferOffset = bufferOffset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
 
@@ -146,7 +162,7 @@ void Application::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t wid
 	region.imageSubresource.baseArrayLayer = 0;
 	region.imageSubresource.layerCount = 1;
 
-	region.imageOffset = {0, 0, 0};
+	region.imageOffset = {0, static_cast<int32_t>(firstRow), 0};
 	region.imageExtent = {
 		width,
 		height,
@@ -161,18 +177,16 @@ void Application::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t wid
 		1,
 		&region
 	);
-
-	endSingleTimeCommands(commandBuffer);
 }
 
-void Application::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Application::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory, uint32_t mipLevels) {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = mipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
@@ -188,14 +202,11 @@ void Application::createImage(uint32_t width, uint32_t height, VkFormat format,
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(this->device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(this->device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
+	/* Optimal tiling images must not share a bufferImageGranularity page with buffers */
+	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	ResourceTiling resourceTiling = tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear;
+	uint32_t category = static_cast<uint32_t>(imageMemoryCategory(usage));
+	imageMemory = this->allocator.allocate(memRequirements, memoryTypeIndex, resourceTiling, AllocationStrategy::Buddy, nullptr, category);
 
-	vkBindImageMemory(this->device, image, imageMemory, 0);
+	vkBindImageMemory(this->device, image, imageMemory.memory, imageMemory.offset);
 }
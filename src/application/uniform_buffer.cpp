@@ -1,30 +1,23 @@
 #include "application.hpp"
 #include "vertex.hpp"
 
-void Application::createMvpUniformBuffers() {
-    VkDeviceSize bufferSize = sizeof(ModelViewPerspective);
+/*
+ * A single uniform buffer, persistently mapped, with one region per frame in flight.
+ * The MVP and the color/texture blending of each frame are bump-allocated in it and bound with dynamic offsets.
+ */
+void Application::createUniformArena() {
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
 
-    this->uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    this->uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    this->uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+	VkDeviceSize bufferSize = UNIFORM_ARENA_FRAME_SIZE * this->framesInFlight;
+	this->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, this->uniformArenaBuffer, this->uniformArenaMemory);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        this->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, this->uniformBuffers[i], this->uniformBuffersMemory[i]);
-		/* Persistent mapping of the uniform buffer memory */
-        vkMapMemory(this->device, this->uniformBuffersMemory[i], 0, bufferSize, 0, &this->uniformBuffersMapped[i]);
-    }
-}
-
-void Application::createColorTextureBlendingBuffer() {
-	VkDeviceSize bufferSize = sizeof(ColorTextureBlending);
-
-	this->textureEnabledBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	this->textureEnabledBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
-	this->textureEnabledBufferMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		this->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, this->textureEnabledBuffers[i], this->textureEnabledBufferMemory[i]);
-		/* Persistent mapping of the uniform buffer memory */
-		vkMapMemory(this->device, this->textureEnabledBufferMemory[i], 0, bufferSize, 0, &this->textureEnabledBufferMapped[i]);
-	}
+	/* Persistent mapping of the uniform buffer memory, done by the allocator */
+	this->uniformArena.init(
+		this->uniformArenaBuffer,
+		this->uniformArenaMemory.mapped,
+		UNIFORM_ARENA_FRAME_SIZE,
+		this->framesInFlight,
+		properties.limits.minUniformBufferOffsetAlignment
+	);
 }
@@ -0,0 +1,27 @@
+#include "application.hpp"
+
+/*
+ * Transfers and layout transitions are recorded in one command buffer of the upload context
+ * and submitted together, instead of one submission and one vkQueueWaitIdle per operation.
+ * The transfers run on the dedicated transfer queue when the device has one, on the graphics queue otherwise.
+ */
+void Application::createUploadContext() {
+	QueueFamilyIndices queueFamilyIndices = this->findQueueFamilies(this->physicalDevice);
+
+	uint32_t transferFamily = queueFamilyIndices.transferFamily.value_or(queueFamilyIndices.graphicsFamily.value());
+	this->uploadContext.init(
+		this->device,
+		this->graphicsQueue, queueFamilyIndices.graphicsFamily.value(),
+		this->transferQueue, transferFamily,
+		&this->stagingRing
+	);
+}
+
+/*
+ * Record the queued upload requests and submit everything without waiting for it.
+ * The uploads end with a barrier (or the acquire half of an ownership transfer) submitted to the graphics queue before the frames using them,
+ * so rendering does not need to wait for the ticket.
+ */
+void Application::flushUploads() {
+	this->uploadTicket = this->uploadContext.flush();
+}
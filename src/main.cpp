@@ -2,6 +2,11 @@
 #include "ft_glm/ft_glm.hpp"
 
 #include "../tests/ft_glm_test.hpp"
+#include "../tests/frustum_culler_test.hpp"
+#include "../tests/occlusion_rasterizer_test.hpp"
+#include "../tests/image_loader_test.hpp"
+#include "../tests/memory_allocator_test.hpp"
+#include "../tests/render_queue_test.hpp"
 #include <glm/glm.hpp>
 
 int main(int argc, char **argv) {
@@ -9,8 +14,24 @@ int main(int argc, char **argv) {
 	// test_ft_glm();
 	// return EXIT_SUCCESS;
 
-	if (argc != 3) {
-		std::cerr << "Usage: " << argv[0] << " <model_path>" << " <texture_path>" << std::endl;
+	// test_frustum_culler();
+	// return EXIT_SUCCESS;
+
+	// test_occlusion_rasterizer();
+	// return EXIT_SUCCESS;
+
+	// test_image_loader();
+	// return EXIT_SUCCESS;
+
+	// test_memory_allocator();
+	// return EXIT_SUCCESS;
+
+	// test_render_queue();
+	// return EXIT_SUCCESS;
+
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " <model_path>" << " <texture_path>" << " [--bench-instances]" << " [--bench-recording]"
+			<< " [--frames-in-flight <1-" << MAX_FRAMES_IN_FLIGHT << ">]" << " [--present-mode <fifo|fifo_relaxed|mailbox|immediate>]" << std::endl;
 		return EXIT_FAILURE;
 	}
 
@@ -19,6 +40,40 @@ int main(int argc, char **argv) {
 	app.setModelPath(argv[1]);
 	app.setTexturePath(argv[2]);
 
+	try {
+		for (int i = 3; i < argc; i++) {
+			std::string option = argv[i];
+			if (option == "--bench-instances") {
+				/* Renders 1 to 1M instances of the model and prints the frame times */
+				app.setInstanceBenchmark(true);
+			} else if (option == "--bench-recording") {
+				/* Records 64K draws split in 1 to one chunk per core and prints the recording times */
+				app.setRecordingBenchmark(true);
+			} else if (option == "--frames-in-flight" && i + 1 < argc) {
+				std::string value = argv[++i];
+				size_t end = 0;
+				unsigned long framesInFlight = std::stoul(value, &end);
+				/* Checked before the cast, which would wrap the values past UINT32_MAX into the valid range */
+				if (end != value.size() || framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+					throw std::runtime_error("invalid frames in flight " + value + "!");
+				}
+				app.setFramesInFlight(static_cast<uint32_t>(framesInFlight));
+			} else if (option == "--present-mode" && i + 1 < argc) {
+				std::string name = argv[++i];
+				const char* const* found = std::find(PRESENT_MODE_NAMES, PRESENT_MODE_NAMES + PRESENT_MODE_COUNT, name);
+				if (found == PRESENT_MODE_NAMES + PRESENT_MODE_COUNT) {
+					throw std::runtime_error("unknown present mode " + name + "!");
+				}
+				app.setPresentMode(PRESENT_MODES[found - PRESENT_MODE_NAMES]);
+			} else {
+				throw std::runtime_error("unknown option " + option + "!");
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	try {
 		app.run();
 	} catch (const std::exception& e) {
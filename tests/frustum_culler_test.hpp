@@ -0,0 +1,101 @@
+#ifndef FRUSTUM_CULLER_TEST_HPP
+#define FRUSTUM_CULLER_TEST_HPP
+
+#include "ft_glm/ft_glm.hpp"
+#include "frustum_culler.hpp"
+#include "thread_pool.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+
+/* Same as in ft_glm_test.hpp, the tests can be included alone */
+#ifndef TEST
+# define TEST(test) std::string color = test ? "\033[32m" : "\033[31m"; \
+	std::cout << color << #test << "\033[0m" << std::endl;
+#endif
+
+/*
+ * This is a testing file to check that the SIMD culling agrees with the scalar one, and to measure how fast both cull.
+ */
+
+/* Camera of the application looking at a cloud of spheres spread around it */
+Frustum makeCullingTestFrustum() {
+	ft::mat4 view = ft::lookAt(ft::vec3(0.0f, 0.0f, 7.0f), ft::vec3(0.0f, 0.0f, 0.0f), ft::vec3(0.0f, 1.0f, 0.0f));
+	ft::mat4 proj = ft::perspective<float>(ft::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	proj[1][1] *= -1;
+	return Frustum::fromMatrix(proj * view);
+}
+
+void fillCullingTestSpheres(FrustumCuller& culler, size_t count) {
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.0f, 5.0f);
+
+	culler.clear();
+	culler.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		BoundingSphere sphere;
+		sphere.center = ft::vec3(position(generator), position(generator), position(generator));
+		sphere.radius = size(generator);
+		culler.push(sphere);
+	}
+}
+
+/* Mean milliseconds of one call of cull over a few runs */
+double measureCulling(const std::function<void()>& cull) {
+	const int runs = 20;
+
+	cull();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < runs; run++) {
+		cull();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+void test_frustum_culler() {
+	Frustum frustum = makeCullingTestFrustum();
+	FrustumCuller culler;
+
+	/* Counts which are not a multiple of the SIMD width exercise the scalar tail */
+	for (size_t count : {0, 1, 7, 13, 1000, 100003}) {
+		fillCullingTestSpheres(culler, count);
+
+		std::vector<uint8_t> expected(count);
+		culler.cullRangeScalar(frustum, 0, count, expected.data());
+
+		std::vector<uint8_t> simd;
+		culler.cull(frustum, simd);
+
+		ThreadPool pool;
+		std::vector<uint8_t> parallel;
+		culler.cull(frustum, parallel, &pool);
+
+		TEST(simd == expected && parallel == expected);
+	}
+
+	/* Objects culled per millisecond, scalar, SIMD and SIMD on every hardware thread */
+	const size_t count = 1000000;
+	fillCullingTestSpheres(culler, count);
+	std::vector<uint8_t> visible(count);
+	ThreadPool pool;
+
+	double scalar = measureCulling([&] { culler.cullRangeScalar(frustum, 0, count, visible.data()); });
+	double simd = measureCulling([&] { culler.cull(frustum, visible); });
+	double parallel = measureCulling([&] { culler.cull(frustum, visible, &pool); });
+
+	std::cout << "culling " << count << " spheres (SIMD width " << FrustumCuller::SIMD_WIDTH << ", " << pool.size() << " workers)" << std::endl;
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "scalar:   " << count / scalar << " objects/ms" << std::endl;
+	std::cout << "simd:     " << count / simd << " objects/ms" << std::endl;
+	std::cout << "parallel: " << count / parallel << " objects/ms" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+#endif // FRUSTUM_CULLER_TEST_HPP
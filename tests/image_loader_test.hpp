@@ -0,0 +1,110 @@
+#ifndef IMAGE_LOADER_TEST_HPP
+#define IMAGE_LOADER_TEST_HPP
+
+#include "image_loader.hpp"
+#include "thread_pool.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <map>
+
+/* Same as in ft_glm_test.hpp, the tests can be included alone */
+#ifndef TEST
+# define TEST(test) std::string color = test ? "\033[32m" : "\033[31m"; \
+	std::cout << color << #test << "\033[0m" << std::endl;
+#endif
+
+/*
+ * This is a testing file to check that a batch decoded on a thread pool gives every image, or the error of its path, once.
+ */
+
+/* P6 image of width x height whose pixel i is (i, i + 1, i + 2) */
+void writeImageLoaderTestPPM(const std::string& path, int width, int height) {
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int i = 0; i < width * height; i++) {
+		file.put(static_cast<char>(i)).put(static_cast<char>(i + 1)).put(static_cast<char>(i + 2));
+	}
+}
+
+bool checkImageLoaderTestPixels(const DecodedImage& image, int width, int height) {
+	if (image.pixels == nullptr || image.width != width || image.height != height) {
+		return false;
+	}
+	for (int i = 0; i < width * height; i++) {
+		const uint8_t* pixel = image.pixels + i * 4;
+		if (pixel[0] != static_cast<uint8_t>(i) || pixel[1] != static_cast<uint8_t>(i + 1) || pixel[2] != static_cast<uint8_t>(i + 2) || pixel[3] != 255) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void test_image_loader() {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "image_loader_test";
+	std::filesystem::create_directories(directory);
+
+	/* Sizes of the valid images, the last path does not exist */
+	std::map<std::string, std::pair<int, int>> sizes;
+	std::vector<std::string> paths;
+	for (int i = 0; i < 16; i++) {
+		std::string path = (directory / ("image_" + std::to_string(i) + ".ppm")).string();
+		sizes[path] = {1 + i * 3, 1 + i};
+		writeImageLoaderTestPPM(path, sizes[path].first, sizes[path].second);
+		paths.push_back(path);
+	}
+	std::string badPath = (directory / "missing.ppm").string();
+	paths.push_back(badPath);
+
+	ThreadPool pool(4);
+
+	{
+		std::map<std::string, int> seen;
+		bool decoded = true;
+		bool badPathFailed = false;
+		ImageLoader::loadImages(paths, pool, [&](DecodedImage&& image) {
+			seen[image.path]++;
+			if (image.path == badPath) {
+				badPathFailed = image.pixels == nullptr && image.error != nullptr;
+			} else {
+				decoded = decoded && image.error == nullptr && checkImageLoaderTestPixels(image, sizes[image.path].first, sizes[image.path].second);
+			}
+			delete[] image.pixels;
+		});
+
+		bool everyPathOnce = seen.size() == paths.size();
+		for (const auto& entry : seen) {
+			everyPathOnce = everyPathOnce && entry.second == 1;
+		}
+		TEST(decoded && badPathFailed && everyPathOnce);
+	}
+
+	{
+		/* A failing callback is rethrown once every task is done, the pool can still be used after it */
+		int calls = 0;
+		bool rethrown = false;
+		try {
+			ImageLoader::loadImages(paths, pool, [&](DecodedImage&& image) {
+				calls++;
+				delete[] image.pixels;
+				throw std::runtime_error("callback failed!");
+			});
+		} catch (const std::runtime_error&) {
+			rethrown = true;
+		}
+		TEST(rethrown && calls == 1);
+	}
+
+	{
+		int count = 0;
+		ImageLoader::loadImages({}, pool, [&](DecodedImage&&) { count++; });
+		TEST(count == 0);
+	}
+
+	std::filesystem::remove_all(directory);
+}
+
+#endif // IMAGE_LOADER_TEST_HPP
@@ -0,0 +1,144 @@
+#ifndef MEMORY_ALLOCATOR_TEST_HPP
+#define MEMORY_ALLOCATOR_TEST_HPP
+
+#include "memory_allocator.hpp"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+/* Same as in ft_glm_test.hpp, the tests can be included alone */
+#ifndef TEST
+# define TEST(test) std::string color = test ? "\033[32m" : "\033[31m"; \
+	std::cout << color << #test << "\033[0m" << std::endl;
+#endif
+
+/*
+ * This is a testing file to check the offsets bookkeeping of the memory blocks, which does not need a device:
+ * the alignment of the ranges, the bufferImageGranularity padding between linear and optimal resources, and the merging of free ranges.
+ */
+
+struct MemoryAllocatorTestRange {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	ResourceTiling tiling;
+};
+
+bool memoryAllocatorTestRangesOverlap(const std::vector<MemoryAllocatorTestRange>& ranges) {
+	for (size_t i = 0; i < ranges.size(); i++) {
+		for (size_t j = i + 1; j < ranges.size(); j++) {
+			if (ranges[i].offset < ranges[j].offset + ranges[j].size && ranges[j].offset < ranges[i].offset + ranges[i].size) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Whether a linear and an optimal range share a page of p_granularity bytes */
+bool memoryAllocatorTestPagesShared(const std::vector<MemoryAllocatorTestRange>& ranges, VkDeviceSize p_granularity) {
+	for (const MemoryAllocatorTestRange& a : ranges) {
+		for (const MemoryAllocatorTestRange& b : ranges) {
+			if (a.tiling != ResourceTiling::Linear || b.tiling != ResourceTiling::Optimal) {
+				continue;
+			}
+			VkDeviceSize aFirst = a.offset / p_granularity, aLast = (a.offset + a.size - 1) / p_granularity;
+			VkDeviceSize bFirst = b.offset / p_granularity, bLast = (b.offset + b.size - 1) / p_granularity;
+			if (aFirst <= bLast && bFirst <= aLast) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Allocate random linear and optimal resources, as MemoryAllocator does, until the block is full */
+std::vector<MemoryAllocatorTestRange> fillMemoryAllocatorTestBlock(BlockMetadata& metadata, VkDeviceSize p_granularity, bool& p_aligned) {
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<VkDeviceSize> size(1, 5000);
+	std::uniform_int_distribution<int> alignmentShift(0, 8);
+
+	std::vector<MemoryAllocatorTestRange> ranges;
+	p_aligned = true;
+	for (int i = 0; i < 200; i++) {
+		ResourceTiling tiling = i % 3 == 0 ? ResourceTiling::Optimal : ResourceTiling::Linear;
+		VkDeviceSize rangeSize = size(generator);
+		VkDeviceSize alignment = VkDeviceSize(1) << alignmentShift(generator);
+		VkDeviceSize requestedAlignment = alignment;
+		MemoryAllocator::padForGranularity(tiling, p_granularity, rangeSize, alignment);
+
+		VkDeviceSize offset, reservedSize;
+		if (!metadata.allocate(rangeSize, alignment, offset, reservedSize)) {
+			break;
+		}
+		p_aligned = p_aligned && offset % requestedAlignment == 0 && reservedSize >= rangeSize;
+		ranges.push_back({offset, rangeSize, tiling});
+	}
+	return ranges;
+}
+
+void test_memory_allocator() {
+	const VkDeviceSize blockSize = 1 << 20;
+	const VkDeviceSize granularity = 1024;
+
+	{
+		BuddyMetadata buddy(blockSize);
+		bool aligned;
+		std::vector<MemoryAllocatorTestRange> ranges = fillMemoryAllocatorTestBlock(buddy, granularity, aligned);
+		bool valid = !ranges.empty() && aligned && !memoryAllocatorTestRangesOverlap(ranges) && !memoryAllocatorTestPagesShared(ranges, granularity);
+
+		/* Freed in another order than allocated, every buddy merges back into the whole block */
+		std::shuffle(ranges.begin(), ranges.end(), std::mt19937(7));
+		for (const MemoryAllocatorTestRange& range : ranges) {
+			buddy.free(range.offset);
+		}
+		bool merged = buddy.freeRangeCount() == 1 && buddy.largestFreeRange() == blockSize;
+		TEST(valid && merged);
+	}
+
+	{
+		/* Only the largest power of two of the block is used, the smallest node is MIN_NODE_SIZE */
+		BuddyMetadata buddy(blockSize + blockSize / 2);
+		VkDeviceSize offset, reservedSize;
+		bool whole = buddy.allocate(blockSize, 1, offset, reservedSize) && offset == 0 && reservedSize == blockSize;
+		bool full = !buddy.allocate(1, 1, offset, reservedSize);
+		buddy.free(0);
+		bool smallest = buddy.allocate(1, 1, offset, reservedSize) && reservedSize == BuddyMetadata::MIN_NODE_SIZE;
+		TEST(whole && full && smallest);
+	}
+
+	{
+		LinearMetadata linear(blockSize);
+		bool aligned;
+		std::vector<MemoryAllocatorTestRange> ranges = fillMemoryAllocatorTestBlock(linear, granularity, aligned);
+		bool valid = !ranges.empty() && aligned && !memoryAllocatorTestRangesOverlap(ranges) && !memoryAllocatorTestPagesShared(ranges, granularity);
+
+		/* The space only comes back once the ranges at the top are freed */
+		VkDeviceSize largest = linear.largestFreeRange();
+		linear.free(ranges.front().offset);
+		bool bottomKept = linear.largestFreeRange() == largest;
+		for (size_t i = ranges.size(); i-- > 1;) {
+			linear.free(ranges[i].offset);
+		}
+		TEST(valid && bottomKept && linear.largestFreeRange() == blockSize && linear.freeRangeCount() == 1);
+	}
+
+	{
+		/* Freeing twice is rejected instead of corrupting the bookkeeping */
+		BuddyMetadata buddy(blockSize);
+		LinearMetadata linear(blockSize);
+		VkDeviceSize offset, reservedSize;
+		buddy.allocate(100, 1, offset, reservedSize);
+		buddy.free(offset);
+		linear.allocate(100, 1, offset, reservedSize);
+		linear.free(offset);
+
+		int rejected = 0;
+		try { buddy.free(offset); } catch (const std::invalid_argument&) { rejected++; }
+		try { linear.free(offset); } catch (const std::invalid_argument&) { rejected++; }
+		TEST(rejected == 2 && buddy.freeRangeCount() == 1);
+	}
+}
+
+#endif // MEMORY_ALLOCATOR_TEST_HPP
@@ -0,0 +1,130 @@
+#ifndef OCCLUSION_RASTERIZER_TEST_HPP
+#define OCCLUSION_RASTERIZER_TEST_HPP
+
+#include "ft_glm/ft_glm.hpp"
+#include "occlusion_rasterizer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+
+/* Same as in ft_glm_test.hpp, the tests can be included alone */
+#ifndef TEST
+# define TEST(test) std::string color = test ? "\033[32m" : "\033[31m"; \
+	std::cout << color << #test << "\033[0m" << std::endl;
+#endif
+
+/*
+ * This is a testing file to check what the occlusion rasterizer culls, that the SIMD rows match the scalar ones,
+ * and to measure how fast it rasterizes and tests.
+ */
+
+/* Camera of the application, looking at a wall in the plane z = 0 */
+ft::mat4 makeOcclusionTestViewProj() {
+	ft::mat4 view = ft::lookAt(ft::vec3(0.0f, 0.0f, 7.0f), ft::vec3(0.0f, 0.0f, 0.0f), ft::vec3(0.0f, 1.0f, 0.0f));
+	ft::mat4 proj = ft::perspective<float>(ft::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	proj[1][1] *= -1;
+	return proj * view;
+}
+
+/* Sphere tested against the wall, and whether it must be visible */
+struct OcclusionTestCase {
+	float x, y, z, radius;
+	bool visible;
+};
+
+void test_occlusion_rasterizer() {
+	ft::mat4 viewProj = makeOcclusionTestViewProj();
+	OccluderMesh wall = OccluderMesh::box(ft::vec3(-3.0f, -3.0f, -0.1f), ft::vec3(3.0f, 3.0f, 0.1f));
+
+	const OcclusionTestCase cases[] = {
+		/* Behind the wall */
+		{0.0f, 0.0f, -5.0f, 0.5f, false},
+		{-2.0f, 1.5f, -20.0f, 1.0f, false},
+		/* In front of the wall */
+		{0.0f, 0.0f, 3.0f, 0.5f, true},
+		/* Behind the wall, but sticking out of its silhouette */
+		{5.5f, 0.0f, -5.0f, 0.5f, true},
+		{0.0f, 0.0f, -5.0f, 5.0f, true},
+		/* The wall does not hide itself */
+		{0.0f, 0.0f, 0.0f, 4.3f, true},
+		/* Around the camera */
+		{0.0f, 0.0f, 7.0f, 1.0f, true}
+	};
+
+	OcclusionRasterizer rasterizer;
+	rasterizer.resize(256, 128);
+	for (bool simd : {true, false}) {
+		rasterizer.setSimd(simd);
+		rasterizer.clear();
+		rasterizer.rasterize(wall, viewProj);
+
+		for (const OcclusionTestCase& testCase : cases) {
+			BoundingSphere sphere;
+			sphere.center = ft::vec3(testCase.x, testCase.y, testCase.z);
+			sphere.radius = testCase.radius;
+			TEST(rasterizer.isSphereVisible(sphere, viewProj) == testCase.visible);
+		}
+	}
+
+	/* The SIMD rows write exactly what the scalar ones do */
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	std::vector<OccluderMesh> boxes;
+	for (int i = 0; i < 1000; i++) {
+		ft::vec3 corner(position(generator), position(generator), position(generator) - 4.0f);
+		ft::vec3 extent(size(generator), size(generator), size(generator));
+		boxes.push_back(OccluderMesh::box(corner, corner + extent));
+	}
+
+	OcclusionRasterizer simd;
+	OcclusionRasterizer scalar;
+	simd.resize(256, 128);
+	scalar.resize(256, 128);
+	scalar.setSimd(false);
+	for (const OccluderMesh& box : boxes) {
+		simd.rasterize(box, viewProj);
+		scalar.rasterize(box, viewProj);
+	}
+	{
+		TEST(simd.getDepth() == scalar.getDepth());
+	}
+
+	/* Triangles rasterized and spheres tested per millisecond */
+	const int runs = 20;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < runs; run++) {
+		simd.clear();
+		for (const OccluderMesh& box : boxes) {
+			simd.rasterize(box, viewProj);
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double rasterizeMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / runs;
+	size_t triangles = boxes.size() * boxes[0].indices.size() / 3;
+
+	std::vector<BoundingSphere> spheres(100000);
+	for (BoundingSphere& sphere : spheres) {
+		sphere.center = ft::vec3(position(generator), position(generator), position(generator) - 8.0f);
+		sphere.radius = size(generator) * 0.25f;
+	}
+	size_t visible = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (const BoundingSphere& sphere : spheres) {
+		visible += simd.isSphereVisible(sphere, viewProj) ? 1 : 0;
+	}
+	end = std::chrono::high_resolution_clock::now();
+	double testMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::cout << "occlusion buffer " << simd.getWidth() << "x" << simd.getHeight() << std::endl;
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "rasterize: " << triangles / rasterizeMilliseconds << " triangles/ms" << std::endl;
+	std::cout << "test:      " << spheres.size() / testMilliseconds << " spheres/ms (" << spheres.size() - visible << " of " << spheres.size() << " hidden)" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+#endif // OCCLUSION_RASTERIZER_TEST_HPP
@@ -0,0 +1,134 @@
+#ifndef RENDER_QUEUE_TEST_HPP
+#define RENDER_QUEUE_TEST_HPP
+
+#include "render_queue.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+/* Same as in ft_glm_test.hpp, the tests can be included alone */
+#ifndef TEST
+# define TEST(test) std::string color = test ? "\033[32m" : "\033[31m"; \
+	std::cout << color << #test << "\033[0m" << std::endl;
+#endif
+
+/*
+ * This is a testing file to check that the radix sort of the render queue orders the draws like std::stable_sort,
+ * that the fields of the keys sort in the intended priority, and to measure how fast both sort.
+ */
+
+/* Few distinct pipelines, materials and meshes so that many keys are equal, the index tells the push order */
+void fillRenderQueueTest(RenderQueue& queue, std::vector<DrawItem>& pushed, size_t count, uint32_t seed) {
+	std::mt19937 generator(seed);
+	std::uniform_int_distribution<uint32_t> pipeline(0, 2);
+	std::uniform_int_distribution<uint32_t> material(0, 5);
+	std::uniform_int_distribution<uint32_t> mesh(0, 40);
+	std::uniform_int_distribution<int> depth(-2, 50);
+
+	queue.clear();
+	pushed.clear();
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = RenderQueue::makeKey(pipeline(generator), material(generator), mesh(generator), static_cast<float>(depth(generator)) * 0.5f);
+		queue.push(key, static_cast<uint32_t>(i));
+		pushed.push_back({key, static_cast<uint32_t>(i)});
+	}
+}
+
+bool sameRenderQueueTestItems(const std::vector<DrawItem>& a, const std::vector<DrawItem>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].key != b[i].key || a[i].index != b[i].index) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void stableSortRenderQueueTest(std::vector<DrawItem>& items) {
+	std::stable_sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+}
+
+void test_render_queue() {
+	RenderQueue queue;
+	std::vector<DrawItem> expected;
+
+	/* Same order and same order of equal keys as std::stable_sort, sorting twice reuses the scratch buffer */
+	{
+		bool stable = true;
+		for (size_t count : {0, 1, 2, 3, 100, 4097, 100000}) {
+			for (uint32_t seed = 0; seed < 2; seed++) {
+				fillRenderQueueTest(queue, expected, count, seed);
+				queue.sort();
+				stableSortRenderQueueTest(expected);
+				stable = stable && sameRenderQueueTestItems(queue.getItems(), expected);
+			}
+		}
+		TEST(stable);
+	}
+
+	/* Every pass skipped: all the keys are equal, the push order is kept */
+	{
+		queue.clear();
+		for (uint32_t i = 0; i < 1000; i++) {
+			queue.push(RenderQueue::makeKey(1, 2, 3, 4.0f), i);
+		}
+		queue.sort();
+		bool kept = true;
+		for (uint32_t i = 0; i < queue.size(); i++) {
+			kept = kept && queue.getItems()[i].index == i;
+		}
+		TEST(kept);
+	}
+
+	/* The pipeline has priority over the material, then the mesh, then the depth (front to back, negative first) */
+	{
+		queue.clear();
+		queue.push(RenderQueue::makeKey(1, 0, 0, 0.5f), 0);
+		queue.push(RenderQueue::makeKey(0, 1, 0, 0.5f), 1);
+		queue.push(RenderQueue::makeKey(0, 0, 1, 0.5f), 2);
+		queue.push(RenderQueue::makeKey(0, 0, 0, 100.0f), 3);
+		queue.push(RenderQueue::makeKey(0, 0, 0, 0.25f), 4);
+		queue.push(RenderQueue::makeKey(0, 0, 0, -3.0f), 5);
+		queue.sort();
+
+		std::vector<uint32_t> order;
+		for (const DrawItem& item : queue.getItems()) {
+			order.push_back(item.index);
+		}
+		uint64_t key = RenderQueue::makeKey(9, 1234, 54321, 1.0f);
+		bool fields = RenderQueue::keyPipeline(key) == 9 && RenderQueue::keyMaterial(key) == 1234 && RenderQueue::keyMesh(key) == 54321;
+		TEST(order == std::vector<uint32_t>({5, 4, 3, 2, 1, 0}) && fields);
+	}
+
+	/* Draws sorted per millisecond, radix sort against std::stable_sort */
+	const size_t count = 1000000;
+	const int runs = 10;
+	double radix = 0.0;
+	double stableSort = 0.0;
+	for (int run = 0; run < runs; run++) {
+		fillRenderQueueTest(queue, expected, count, run);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		queue.sort();
+		auto middle = std::chrono::high_resolution_clock::now();
+		stableSortRenderQueueTest(expected);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		radix += std::chrono::duration<double, std::milli>(middle - start).count();
+		stableSort += std::chrono::duration<double, std::milli>(end - middle).count();
+	}
+
+	std::cout << "sorting " << count << " draws" << std::endl;
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "radix sort:  " << count * runs / radix << " draws/ms" << std::endl;
+	std::cout << "stable_sort: " << count * runs / stableSort << " draws/ms" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+#endif // RENDER_QUEUE_TEST_HPP